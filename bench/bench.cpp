@@ -0,0 +1,1019 @@
+/*
+ * Benchmarks of the rendering and refresh hot paths.
+ *
+ * Results are printed to the standard output as CSV, one line per benchmark
+ * and parameter, so that runs of different commits can be compared:
+ *
+ *     benchmark,param,iterations,ns_per_op,allocs_per_op,spi_bytes_per_op,
+ *     spi_messages_per_op,spi_noop_bytes_per_op,spi_redundant_bytes_per_op
+ *
+ * The NoOp padding and redundant register writes are only known, and only
+ * printed, for benchmarks run on the emulated MAX7219 chain. The refresh
+ * benchmarks must not allocate once warmed up, and fail the run otherwise.
+ *
+ * Usage: clock_bench [--min-time=<seconds>] [filter]
+ *
+ * Only the benchmarks whose name contains the filter are run.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "device/display/composite.hpp"
+#include "device/display/max7219.hpp"
+#include "device/spi/max7219-emulator.hpp"
+#include "device/spi/null.hpp"
+#include "font/font5x7.hpp"
+#include "font/font8x8.hpp"
+#include "util/bitblit-reference.hpp"
+#include "util/column-source.hpp"
+#include "util/event-loop.hpp"
+#include "util/painter.hpp"
+#include "util/screenbuffer.hpp"
+#include "util/scrolling-display.hpp"
+#include "util/terminal-renderer.hpp"
+
+namespace
+{
+
+/** Number of heap allocations made by the process. */
+std::atomic<unsigned long long> gAllocations{0U};
+
+/** Sink for the results of the benchmarked operations. */
+volatile unsigned int gSink = 0U;
+
+} // namespace
+
+/*
+ * The counting replacements are kept out of line: once inlined, GCC pairs the
+ * std::free() below with the new-expression of the caller and reports the
+ * (deliberate) mismatch.
+ */
+__attribute__((noinline)) void *operator new(std::size_t size)
+{
+    gAllocations++;
+
+    void *ptr = std::malloc(size != 0U ? size : 1U);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+__attribute__((noinline)) void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void *ptr,
+                                               std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace Bench
+{
+
+using Clock = std::chrono::steady_clock;
+
+/** SPI traffic counters, in bytes and messages. */
+struct Traffic {
+    double bytes          = 0.0;
+    double messages       = 0.0;
+    double noOpBytes      = 0.0;
+    double redundantBytes = 0.0;
+
+    /** True if the NoOp and redundant bytes are known. */
+    bool detailed = false;
+};
+
+Traffic traffic(const Device::Spi::Null *spi)
+{
+    Traffic result;
+    if (spi != nullptr) {
+        result.bytes    = static_cast<double>(spi->getBytes());
+        result.messages = static_cast<double>(spi->getMessages());
+    }
+
+    return result;
+}
+
+Traffic traffic(const Device::Spi::Max7219Emulator *spi)
+{
+    const auto &stats = spi->getStats();
+    auto cmdLen       = Device::Spi::Max7219Emulator::kCmdLen;
+
+    Traffic result;
+    result.bytes          = static_cast<double>(stats.bytes);
+    result.messages       = static_cast<double>(stats.messages);
+    result.noOpBytes      = static_cast<double>(stats.noOps * cmdLen);
+    result.redundantBytes = static_cast<double>(stats.redundantWrites * cmdLen);
+    result.detailed       = true;
+
+    return result;
+}
+
+/**
+ * Runs the benchmarks and prints their results.
+ */
+class Suite
+{
+    public:
+    Suite(const std::string &filter, double minTime)
+        : mFilter(filter), mMinTime(minTime)
+    {
+        std::cout << "benchmark,param,iterations,ns_per_op,allocs_per_op,"
+                     "spi_bytes_per_op,spi_messages_per_op,"
+                     "spi_noop_bytes_per_op,spi_redundant_bytes_per_op"
+                  << std::endl;
+    }
+
+    /**
+     * Checks if the benchmark is selected by the filter.
+     *
+     * @param[in] name The name of the benchmark.
+     *
+     * @return True if the benchmark should run.
+     */
+    bool selected(const std::string &name) const
+    {
+        return name.find(mFilter) != std::string::npos;
+    }
+
+    /**
+     * Runs the operation repeatedly, for at least the minimal time, and
+     * prints the average cost of a single call.
+     *
+     * @param[in] name  The name of the benchmark.
+     * @param[in] param The parameter of the benchmark, eg. the width.
+     * @param[in] op    The operation.
+     * @param[in] spi   The SPI device used by the operation, or nullptr.
+     *
+     * @return The number of allocations made by the measured calls.
+     */
+    template <typename Op, typename Spi = Device::Spi::Null>
+    unsigned long long run(const std::string &name,
+                           unsigned int param,
+                           Op op,
+                           const Spi *spi = nullptr)
+    {
+        if (!selected(name)) {
+            return 0U;
+        }
+
+        /* Warm up, so that one-time allocations are not accounted */
+        op();
+
+        unsigned long long iterations = 1U;
+        for (;;) {
+            auto allocations = gAllocations.load();
+            auto before      = traffic(spi);
+            auto start       = Clock::now();
+
+            for (auto i = 0ULL; i < iterations; i++) {
+                op();
+            }
+
+            std::chrono::duration<double> elapsed = Clock::now() - start;
+            if (elapsed.count() >= mMinTime || iterations >= (1ULL << 40U)) {
+                auto n       = static_cast<double>(iterations);
+                auto after   = traffic(spi);
+                auto counted = gAllocations.load() - allocations;
+                auto allocs  = static_cast<double>(counted);
+
+                std::cout << name << "," << param << "," << iterations << ","
+                          << elapsed.count() * 1e9 / n << "," << allocs / n
+                          << "," << (after.bytes - before.bytes) / n << ","
+                          << (after.messages - before.messages) / n << ",";
+                if (after.detailed) {
+                    std::cout << (after.noOpBytes - before.noOpBytes) / n
+                              << ","
+                              << (after.redundantBytes -
+                                  before.redundantBytes) /
+                                     n;
+                } else {
+                    std::cout << ",";
+                }
+                std::cout << std::endl;
+                return counted;
+            }
+
+            iterations *= 2U;
+        }
+    }
+
+    /**
+     * Runs the operation like run() does, failing if it allocates once warmed
+     * up. Used for the steady state of the refresh, which must not allocate.
+     *
+     * @param[in] name  The name of the benchmark.
+     * @param[in] param The parameter of the benchmark, eg. the width.
+     * @param[in] op    The operation.
+     * @param[in] spi   The SPI device used by the operation, or nullptr.
+     */
+    template <typename Op, typename Spi = Device::Spi::Null>
+    void runWithoutAllocations(const std::string &name,
+                               unsigned int param,
+                               Op op,
+                               const Spi *spi = nullptr)
+    {
+        if (run(name, param, op, spi) != 0U) {
+            fail(name, param, "allocates in the steady state");
+        }
+    }
+
+    /**
+     * Reports a result that does not match the expected one.
+     *
+     * @param[in] name   The name of the benchmark.
+     * @param[in] param  The parameter of the benchmark.
+     * @param[in] reason What is wrong with the result.
+     */
+    void fail(const std::string &name,
+              unsigned int param,
+              const char *reason = "result differs from the expected one")
+    {
+        std::cerr << name << "/" << param << ": " << reason << std::endl;
+        mFailed = true;
+    }
+
+    /**
+     * Returns true if any result did not match the expected one.
+     */
+    bool failed() const
+    {
+        return mFailed;
+    }
+
+    private:
+    std::string mFilter;
+    double mMinTime;
+    bool mFailed = false;
+};
+
+/** Display widths the width dependent benchmarks are run with. */
+const std::vector<unsigned int> kWidths = {
+    8U, 16U, 32U, 64U, 128U, 256U, 512U, 1024U, 2048U};
+
+/**
+ * Fills the buffer with a pseudo random pattern.
+ */
+void scramble(Util::ScreenBuffer *buffer, unsigned int seed)
+{
+    for (auto y = 0U; y < buffer->getHeight(); y++) {
+        for (auto x = 0U; x < buffer->getSegmentCnt() * 8U; x++) {
+            seed = seed * 1103515245U + 12345U;
+            buffer->putBit(x, y, ((seed >> 16U) & 0x1U) != 0U);
+        }
+    }
+}
+
+/**
+ * Checks if the buffers hold the same pixels.
+ */
+bool same(const Util::ScreenBuffer &a, const Util::ScreenBuffer &b)
+{
+    for (auto y = 0U; y < a.getHeight(); y++) {
+        for (auto x = 0U; x < a.getSegmentCnt() * 8U; x++) {
+            if (a.getBit(x, y) != b.getBit(x, y)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Returns a text of the given length.
+ */
+std::string makeText(unsigned int length)
+{
+    std::string text;
+    for (auto i = 0U; i < length; i++) {
+        text += static_cast<char>('0' + i % 75U);
+    }
+
+    return text;
+}
+
+void screenBuffer(Suite *suite)
+{
+    for (auto width : kWidths) {
+        Util::ScreenBuffer buffer(width);
+        scramble(&buffer, width);
+
+        suite->run("screenbuffer_shift_left", width, [&]() {
+            gSink = buffer.shiftLeft(buffer.getColumn(0U));
+        });
+
+        unsigned int x = 0U;
+        suite->run("screenbuffer_get_column", width, [&]() {
+            gSink = buffer.getColumn(x);
+            x     = (x + 1U) % width;
+        });
+    }
+
+    for (auto width : kWidths) {
+        suite->run("screenbuffer_put_bit_expanding", width, [&]() {
+            Util::ScreenBuffer buffer(0U);
+            for (auto x = 0U; x < width; x++) {
+                buffer.putBitExpanding(x, x % 8U, true);
+            }
+            gSink = buffer.getSegmentCnt();
+        });
+    }
+}
+
+/**
+ * Checks the word-parallel bit-blit operations against the reference ones on
+ * a buffer of the given width, 16 pixels high. Fixed cases cover the bulk
+ * path of equally aligned spans and the overlapping blits within a buffer,
+ * in every direction and with every operation; random ones cover the
+ * clipping.
+ *
+ * @return True if all the results match.
+ */
+bool verifyBitBlit(unsigned int width)
+{
+    using Op = Util::BitBlit::Op;
+    namespace Reference = Util::BitBlitReference;
+
+    const Op ops[]      = {Op::copy, Op::bitOr, Op::bitXor, Op::bitAnd};
+    const auto height   = 16U;
+    unsigned int random = width;
+
+    Util::ScreenBuffer src(width, height);
+    Util::ScreenBuffer dst(width, height);
+    Util::ScreenBuffer ref(width, height);
+    scramble(&src, 1U);
+
+    auto next = [&random](unsigned int limit) {
+        random = random * 1103515245U + 12345U;
+        return (random >> 8U) % limit;
+    };
+
+    struct {
+        unsigned int srcX, srcY, width, height, dstX, dstY;
+        bool self;
+    } const blits[] = {
+        /* Equally aligned spans of more than two words */
+        {0U, 0U, width, height, 0U, 0U, false},
+        {64U, 0U, width, 8U, 128U, 3U, false},
+        {128U, 5U, width, 8U, 64U, 0U, false},
+        {64U, 0U, width, 8U, 64U, 8U, true},
+        {0U, 8U, 200U, 8U, 192U, 0U, true},
+
+        /* Overlapping regions: right, left, down and up */
+        {3U, 2U, width, 8U, 17U, 2U, true},
+        {17U, 2U, width, 8U, 3U, 2U, true},
+        {64U, 1U, width, 8U, 128U, 1U, true},
+        {128U, 1U, width, 8U, 64U, 1U, true},
+        {5U, 0U, width, 12U, 5U, 3U, true},
+        {5U, 3U, width, 12U, 9U, 0U, true},
+    };
+
+    for (const auto &b : blits) {
+        for (auto op : ops) {
+            scramble(&dst, b.srcX + b.dstX + b.dstY);
+            ref = dst;
+
+            dst.blit(b.self ? dst : src,
+                     b.srcX,
+                     b.srcY,
+                     b.width,
+                     b.height,
+                     b.dstX,
+                     b.dstY,
+                     op);
+            Reference::blit(&ref,
+                            b.self ? ref : src,
+                            b.srcX,
+                            b.srcY,
+                            b.width,
+                            b.height,
+                            b.dstX,
+                            b.dstY,
+                            op);
+            if (!same(dst, ref)) {
+                return false;
+            }
+        }
+    }
+
+    scramble(&dst, 2U);
+    ref = dst;
+
+    for (auto i = 0U; i < 256U; i++) {
+        auto x = next(width + 8U);
+        auto y = next(height + 2U);
+        auto w = next(width + 8U);
+        auto h = next(height + 2U);
+
+        switch (next(5U)) {
+        case 0U:
+        case 1U: {
+            bool self = next(2U) != 0U;
+            auto srcX = next(width + 8U);
+            auto srcY = next(height);
+            auto op   = ops[next(4U)];
+
+            dst.blit(self ? dst : src, srcX, srcY, w, h, x, y, op);
+            Reference::blit(
+                &ref, self ? ref : src, srcX, srcY, w, h, x, y, op);
+            break;
+        }
+        case 2U: {
+            bool pixel = next(2U) != 0U;
+            dst.fill(x, y, w, h, pixel);
+            Reference::fill(&ref, x, y, w, h, pixel);
+            break;
+        }
+        case 3U:
+            dst.invert(x, y, w, h);
+            Reference::invert(&ref, x, y, w, h);
+            break;
+        default: {
+            /* Whole words now and then, which are moved rather than shifted */
+            auto cnt = next(4U) == 0U ? x / 64U * 64U : x / 8U;
+            dst.shiftColumnsLeft(cnt);
+            Reference::shiftColumnsLeft(&ref, cnt);
+            break;
+        }
+        }
+
+        if (!same(dst, ref)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void bitBlit(Suite *suite)
+{
+    for (auto width : kWidths) {
+        Util::ScreenBuffer src(width);
+        Util::ScreenBuffer dst(width);
+        Util::ScreenBuffer ref(width);
+        scramble(&src, 1U);
+        scramble(&dst, 2U);
+        scramble(&ref, 2U);
+
+        auto shift = width / 3U + 1U;
+        auto x     = width / 5U;
+        auto w     = width - x;
+
+        /* Verify the word-parallel results against the reference first */
+        if (!verifyBitBlit(width)) {
+            suite->fail("bitblit", width);
+        }
+
+        suite->run("bitblit_shift_columns", width, [&]() {
+            dst.shiftColumnsLeft(shift);
+        });
+        suite->run("bitblit_shift_columns_reference", width, [&]() {
+            Util::BitBlitReference::shiftColumnsLeft(&ref, shift);
+        });
+        suite->run("bitblit_blit_or", width, [&]() {
+            dst.blit(src, 3U, 0U, w, 8U, x, 0U, Util::BitBlit::Op::bitOr);
+        });
+        suite->run("bitblit_blit_or_reference", width, [&]() {
+            Util::BitBlitReference::blit(
+                &ref, src, 3U, 0U, w, 8U, x, 0U, Util::BitBlit::Op::bitOr);
+        });
+        suite->run("bitblit_invert", width, [&]() {
+            dst.invert(x, 0U, w, 8U);
+        });
+        suite->run("bitblit_invert_reference", width, [&]() {
+            Util::BitBlitReference::invert(&ref, x, 0U, w, 8U);
+        });
+    }
+}
+
+void terminalRenderer(Suite *suite)
+{
+    using Mode = Util::TerminalRenderer::Mode;
+
+    auto fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    for (auto width : kWidths) {
+        Util::ScreenBuffer buffer(width);
+        Util::TerminalRenderer append(fd, Mode::append, {});
+        Util::TerminalRenderer inPlace(fd, Mode::inPlace, {});
+
+        scramble(&buffer, width);
+
+        uint8_t column = 0U;
+        suite->run("terminal_render_append", width, [&]() {
+            column = buffer.shiftLeft(column);
+            append.render(buffer);
+        });
+        suite->run("terminal_render_in_place", width, [&]() {
+            column = buffer.shiftLeft(column);
+            inPlace.render(buffer);
+        });
+    }
+
+    ::close(fd);
+}
+
+template <typename Font> void writeText(Suite *suite, const std::string &name)
+{
+    Device::Spi::Null spi;
+    Device::Display::Max7219 display(spi, 32U, false);
+    Util::ScrollingDisplay scrolling(&display);
+
+    for (auto length : {4U, 16U, 64U, 256U}) {
+        auto text = makeText(length);
+
+        suite->run(name, length, [&]() {
+            scrolling.clear();
+            gSink = Util::Painter::writeText<Font>(&scrolling, 0U, 0U, text);
+        });
+    }
+}
+
+void painter(Suite *suite)
+{
+    writeText<Font::Font5by7>(suite, "painter_write_text_5x7");
+    writeText<Font::Font8by8>(suite, "painter_write_text_8x8");
+}
+
+void scrollingDisplay(Suite *suite)
+{
+    for (auto width : kWidths) {
+        Device::Spi::Null spi;
+        Device::Display::Max7219 display(spi, width, false);
+        Util::ScrollingDisplay scrolling(&display);
+
+        Util::Painter::writeText<Font::Font5by7>(
+            &scrolling, 0U, 0U, makeText(width / 6U + 1U));
+
+        suite->run(
+            "scrolling_display_slide_in",
+            width,
+            [&]() { gSink = scrolling.slideIn(); },
+            &spi);
+    }
+
+    /* Rendering into a new display, growing it or reserving it up front */
+    for (auto length : {64U, 256U, 1024U, 4096U, 16384U}) {
+        Device::Spi::Null spi;
+        Device::Display::Max7219 display(spi, 32U, false);
+        auto text = makeText(length);
+
+        suite->run("scrolling_display_render_growing", length, [&]() {
+            Util::ScrollingDisplay scrolling(&display);
+            gSink = Util::Painter::writeText<Font::Font5by7>(
+                &scrolling, 0U, 0U, text);
+        });
+
+        suite->run("scrolling_display_render_reserved", length, [&]() {
+            Util::ScrollingDisplay scrolling(&display);
+            scrolling.reserve(
+                Util::Painter::measureText<Font::Font5by7>(text));
+            gSink = Util::Painter::writeText<Font::Font5by7>(
+                &scrolling, 0U, 0U, text);
+        });
+    }
+
+    /* The time to show the first column of a text, rendered or streamed */
+    Device::Spi::Null spi;
+    Device::Display::Max7219 display(spi, 32U, false);
+    Util::ScrollingDisplay rendered(&display);
+    Util::ScrollingDisplay streamed(&display);
+
+    for (auto length : {64U, 1024U, 16384U}) {
+        auto text = makeText(length);
+        Util::TextColumns<Font::Font5by7> columns(text);
+
+        suite->run("scrolling_display_render_start", length, [&]() {
+            rendered.clear();
+            Util::Painter::writeText<Font::Font5by7>(&rendered, 0U, 0U, text);
+            gSink = rendered.slideIn();
+        });
+
+        suite->run("scrolling_display_stream_start", length, [&]() {
+            streamed.stream(&columns);
+            gSink = streamed.slideIn();
+        });
+    }
+}
+
+void max7219(Suite *suite)
+{
+    using Mode = Device::Display::Max7219::RefreshMode;
+
+    struct {
+        Mode mode;
+        const char *name;
+    } const modes[] = {
+        {Mode::rowBatched, "row_batched"},
+        {Mode::perSegment, "per_segment"},
+    };
+
+    for (const auto &mode : modes) {
+        auto prefix = std::string("max7219_refresh_") + mode.name;
+
+        for (auto width : kWidths) {
+            Device::Spi::Null spi;
+            Device::Display::Max7219 display(spi, width, false, mode.mode);
+
+            for (auto x = 0U; x < width; x += 3U) {
+                display.setPixel(x, x % 8U);
+            }
+
+            /* Every segment is sent, as after a glitch */
+            suite->runWithoutAllocations(
+                prefix + "_full",
+                width,
+                [&]() {
+                    display.invalidate();
+                    display.refresh();
+                },
+                &spi);
+
+            /* Scrolling content, most segments change every frame */
+            uint8_t column = 0U;
+            suite->runWithoutAllocations(
+                prefix + "_scroll",
+                width,
+                [&]() {
+                    column = display.shiftLeft(column);
+                    display.refresh();
+                },
+                &spi);
+
+            /* Static content, nothing needs to be sent */
+            suite->runWithoutAllocations(
+                prefix + "_static", width, [&]() { display.refresh(); }, &spi);
+        }
+    }
+}
+
+/**
+ * Refreshes the display on the emulated MAX7219 chain, checking that the
+ * emulated display shows the expected pixels after every refresh, and
+ * measures the bus efficiency of the refresh modes.
+ */
+void max7219Emulated(Suite *suite)
+{
+    using Mode = Device::Display::Max7219::RefreshMode;
+
+    struct {
+        Mode mode;
+        const char *name;
+    } const modes[] = {
+        {Mode::rowBatched, "row_batched"},
+        {Mode::perSegment, "per_segment"},
+    };
+
+    for (const auto &mode : modes) {
+        auto prefix = std::string("max7219_emulated_") + mode.name;
+        if (!suite->selected(prefix)) {
+            continue;
+        }
+
+        for (auto width : kWidths) {
+            Device::Spi::Max7219Emulator chain(width / 8U);
+            Device::Display::Max7219 display(chain, width, false, mode.mode);
+            Util::ScreenBuffer expected(width);
+
+            scramble(&expected, width);
+            for (auto y = 0U; y < Util::ScreenBuffer::kHeight; y++) {
+                for (auto x = 0U; x < width; x++) {
+                    display.putPixel(x, y, expected.getBit(x, y));
+                }
+            }
+
+            /* Keyframes and partial updates must both end up on the chain */
+            display.setKeyframeInterval(16U);
+
+            uint8_t column         = 0U;
+            uint8_t expectedColumn = 0U;
+            for (auto frame = 0U; frame < 2U * width + 16U; frame++) {
+                column         = display.shiftLeft(column);
+                expectedColumn = expected.shiftLeft(expectedColumn);
+                display.refresh();
+
+                auto shown = true;
+                for (auto y = 0U; y < Util::ScreenBuffer::kHeight; y++) {
+                    for (auto x = 0U; x < width; x++) {
+                        shown = shown &&
+                                chain.getPixel(x, y) == expected.getBit(x, y);
+                    }
+                }
+
+                if (!shown) {
+                    suite->fail(prefix, width);
+                    break;
+                }
+            }
+
+            suite->runWithoutAllocations(
+                prefix + "_full",
+                width,
+                [&]() {
+                    display.invalidate();
+                    display.refresh();
+                },
+                &chain);
+
+            suite->runWithoutAllocations(
+                prefix + "_scroll",
+                width,
+                [&]() {
+                    column = display.shiftLeft(column);
+                    display.refresh();
+                },
+                &chain);
+        }
+    }
+}
+
+/**
+ * Refreshes a display split across several emulated MAX7219 chains,
+ * checking that the chains together show the expected pixels, and measures
+ * how the refresh time scales with the number of chains.
+ */
+void composite(Suite *suite)
+{
+    const unsigned int chainCnts[] = {1U, 2U, 4U};
+
+    for (auto chainCnt : chainCnts) {
+        auto prefix = "composite_emulated_" + std::to_string(chainCnt) +
+                      "_chains";
+        if (!suite->selected(prefix)) {
+            continue;
+        }
+
+        for (auto width : {256U, 1024U, 2048U}) {
+            auto chainWidth = width / chainCnt;
+
+            std::vector<std::unique_ptr<Device::Spi::Max7219Emulator>> spis;
+            std::vector<std::unique_ptr<Device::Display::Max7219>> chains;
+            std::vector<Device::Display::Composite::Chain> parts;
+            for (auto i = 0U; i < chainCnt; i++) {
+                spis.emplace_back(
+                    std::make_unique<Device::Spi::Max7219Emulator>(
+                        chainWidth / 8U));
+                chains.emplace_back(std::make_unique<Device::Display::Max7219>(
+                    *spis.back(), chainWidth, false));
+                parts.push_back({chains.back().get(), chainWidth});
+            }
+
+            Device::Display::Composite display(parts);
+            Util::ScreenBuffer expected(width);
+
+            scramble(&expected, width);
+            for (auto y = 0U; y < Util::ScreenBuffer::kHeight; y++) {
+                for (auto x = 0U; x < width; x++) {
+                    display.putPixel(x, y, expected.getBit(x, y));
+                }
+            }
+
+            uint8_t column         = 0U;
+            uint8_t expectedColumn = 0U;
+            for (auto frame = 0U; frame < 16U; frame++) {
+                column         = display.shiftLeft(column);
+                expectedColumn = expected.shiftLeft(expectedColumn);
+                display.refresh();
+
+                auto shown = true;
+                for (auto y = 0U; y < Util::ScreenBuffer::kHeight; y++) {
+                    for (auto x = 0U; x < width; x++) {
+                        shown = shown && spis[x / chainWidth]->getPixel(
+                                             x % chainWidth, y) ==
+                                             expected.getBit(x, y);
+                    }
+                }
+
+                if (!shown) {
+                    suite->fail(prefix, width);
+                    break;
+                }
+            }
+
+            suite->runWithoutAllocations(prefix + "_scroll", width, [&]() {
+                column = display.shiftLeft(column);
+                display.refresh();
+            });
+        }
+    }
+}
+
+/**
+ * Refreshes a grid of 8x4 modules on the emulated MAX7219 chain, in several
+ * arrangements, checking every pixel against the per-pixel definition of
+ * the geometry, and measures the cost of the mapping.
+ */
+void max7219Grid(Suite *suite)
+{
+    using Geometry = Device::Display::Geometry;
+
+    struct {
+        Geometry geometry;
+        const char *name;
+    } const layouts[] = {
+        {Geometry::grid(8U, 4U), "rows"},
+        {Geometry::grid(8U,
+                        4U,
+                        Geometry::Wiring::serpentine,
+                        Geometry::Rotation::clockwise90),
+         "serpentine_rotated"},
+        {Geometry::grid(8U,
+                        4U,
+                        Geometry::Wiring::serpentine,
+                        Geometry::Rotation::clockwise270,
+                        true),
+         "serpentine_rotated_mirrored"},
+    };
+
+    for (const auto &layout : layouts) {
+        auto prefix = std::string("max7219_grid_") + layout.name;
+        if (!suite->selected(prefix)) {
+            continue;
+        }
+
+        const auto &geometry = layout.geometry;
+        auto moduleCnt       = geometry.getModuleCnt();
+
+        Device::Spi::Max7219Emulator chain(moduleCnt);
+        Device::Display::Max7219 display(chain, geometry, false);
+        Util::ScreenBuffer expected(geometry.getWidth(), geometry.getHeight());
+
+        scramble(&expected, moduleCnt);
+        for (auto y = 0U; y < geometry.getHeight(); y++) {
+            for (auto x = 0U; x < geometry.getWidth(); x++) {
+                display.putPixel(x, y, expected.getBit(x, y));
+            }
+        }
+
+        uint8_t column         = 0U;
+        uint8_t expectedColumn = 0U;
+        for (auto frame = 0U; frame < geometry.getWidth(); frame++) {
+            column         = display.shiftLeft(column);
+            expectedColumn = expected.shiftLeft(expectedColumn);
+            display.refresh();
+
+            auto shown = true;
+            for (auto y = 0U; y < geometry.getHeight(); y++) {
+                for (auto x = 0U; x < geometry.getWidth(); x++) {
+                    auto pixel = geometry.locate(x, y);
+                    shown      = shown &&
+                            chain.getPixel(pixel.module * 8U + pixel.bit,
+                                           7U - pixel.digit) ==
+                                expected.getBit(x, y);
+                }
+            }
+
+            if (!shown) {
+                suite->fail(prefix, moduleCnt);
+                break;
+            }
+        }
+
+        suite->runWithoutAllocations(
+            prefix + "_full",
+            moduleCnt,
+            [&]() {
+                display.invalidate();
+                display.refresh();
+            },
+            &chain);
+
+        suite->runWithoutAllocations(
+            prefix + "_scroll",
+            moduleCnt,
+            [&]() {
+                column = display.shiftLeft(column);
+                display.refresh();
+            },
+            &chain);
+    }
+}
+
+/**
+ * Drives the event loop with a pipe, whose handler removes itself, and a
+ * SIGTERM sent to the process, checking that the handlers are called, that
+ * sleeping keeps to the deadline and that the signal stops the loop, and
+ * measures the cost of dispatching the readiness of a file descriptor.
+ *
+ * SIGTERM stays blocked afterwards, so this is run last.
+ */
+void eventLoop(Suite *suite)
+{
+    const std::string name = "event_loop";
+    if (!suite->selected(name)) {
+        return;
+    }
+
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        suite->fail(name, 0U, "can't create pipe");
+        return;
+    }
+
+    Util::EventLoop loop;
+    char byte            = 0;
+    unsigned int reads   = 0U;
+    unsigned int signals = 0U;
+
+    auto drain = [&](uint32_t) {
+        if (::read(fds[0], &byte, 1U) == 1) {
+            reads++;
+        }
+    };
+
+    /* Dispatching a byte written to the pipe, without waiting */
+    loop.add(fds[0], EPOLLIN, drain);
+    suite->run(name + "_dispatch", 1U, [&]() {
+        if (::write(fds[1], &byte, 1U) == 1) {
+            loop.sleepUntil(loop.now());
+        }
+    });
+
+    /* The handler removes itself, so the second byte is not read */
+    reads = 0U;
+    loop.add(fds[0], EPOLLIN, [&](uint32_t events) {
+        drain(events);
+        loop.remove(fds[0]);
+    });
+
+    auto start    = loop.now();
+    auto deadline = start + std::chrono::milliseconds(20);
+    if (::write(fds[1], "ab", 2U) != 2) {
+        suite->fail(name, 1U, "can't write to pipe");
+    }
+    loop.sleepUntil(deadline);
+
+    if (reads != 1U || loop.now() < deadline || loop.isStopped()) {
+        suite->fail(name, 1U);
+    }
+
+    /* A signal received while sleeping stops the loop and wakes it up */
+    loop.addSignal(SIGTERM, [&](int) {
+        signals++;
+        loop.stop();
+    });
+    ::kill(::getpid(), SIGTERM);
+
+    start = loop.now();
+    loop.sleepFor(std::chrono::seconds(10));
+
+    if (signals != 1U || !loop.isStopped() ||
+        loop.now() - start >= std::chrono::seconds(1)) {
+        suite->fail(name, 2U);
+    }
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+} // namespace Bench
+
+int main(int argc, char *argv[])
+{
+    std::string filter;
+    double minTime = 0.05;
+
+    for (auto i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0U, 11U, "--min-time=") == 0) {
+            minTime = std::atof(arg.c_str() + 11U);
+        } else {
+            filter = arg;
+        }
+    }
+
+    Bench::Suite suite(filter, minTime);
+
+    Bench::screenBuffer(&suite);
+    Bench::bitBlit(&suite);
+    Bench::terminalRenderer(&suite);
+    Bench::painter(&suite);
+    Bench::scrollingDisplay(&suite);
+    Bench::max7219(&suite);
+    Bench::max7219Emulated(&suite);
+    Bench::max7219Grid(&suite);
+    Bench::composite(&suite);
+    Bench::eventLoop(&suite);
+
+    return suite.failed() ? 1 : 0;
+}
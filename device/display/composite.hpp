@@ -0,0 +1,375 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "display-base.hpp"
+#include "util/screenbuffer.hpp"
+
+namespace Device
+{
+
+namespace Display
+{
+
+/**
+ * Display made of several physical displays placed side by side, typically
+ * MAX7219 chains on separate SPI buses, so that a wide display is not
+ * limited by the bandwidth of a single bus.
+ *
+ * Drawing operations are applied to a screen buffer spanning all the
+ * chains. On refresh(), each chain is handed its part of the frame and all
+ * the chains are refreshed concurrently: the first one on the thread of the
+ * caller, the others on threads of their own. refresh() returns once every
+ * chain shows the new frame, so the chains always move to the next frame
+ * together, and a frame takes as long as the slowest chain rather than the
+ * sum of all of them. Errors raised by a chain are rethrown by refresh().
+ *
+ * The chains are handed their parts as columns of 8 pixels, so only chains
+ * 8 pixels high, a single row of modules each, are supported.
+ */
+class Composite : public Device::Display::DisplayBase
+{
+    public:
+    /** A physical display, making a part of the composite one. */
+    struct Chain {
+        /**
+         * The display, only refreshed by the composite from now on. Must be
+         * 8 pixels high.
+         */
+        Device::Display::DisplayBase *display;
+
+        /** The width of the display, in pixels. */
+        unsigned int width;
+    };
+
+    /**
+     * Constructs the display and starts the refresh threads.
+     *
+     * @param[in] chains The physical displays, from left to right.
+     */
+    explicit Composite(const std::vector<Chain> &chains)
+        : mBuffer(totalWidth(chains))
+    {
+        auto x = 0U;
+        for (const auto &chain : chains) {
+            mChains.emplace_back(std::make_unique<Worker>(chain, x));
+            x += chain.width;
+        }
+
+        /* The destructor does not run if this throws, stop here instead */
+        try {
+            for (auto i = 1U; i < mChains.size(); i++) {
+                auto *worker = mChains[i].get();
+                worker->mThread =
+                    std::thread([this, worker]() { run(worker); });
+            }
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    /**
+     * Stops the refresh threads.
+     */
+    virtual ~Composite() override
+    {
+        stop();
+    }
+
+    Composite(const Composite &) = delete;
+    Composite &operator=(const Composite &) = delete;
+
+    /**
+     * Shows the content of the screen buffer on all the chains, returning
+     * once all of them show it.
+     */
+    void refresh() override
+    {
+        for (auto &worker : mChains) {
+            mBuffer.getColumns(
+                worker->mOffset, worker->mChain.width, worker->mColumns.data());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mGeneration++;
+            mPending = static_cast<unsigned int>(mChains.size()) - 1U;
+        }
+        mStart.notify_all();
+
+        /* The first chain is refreshed here, saving a thread hand-off */
+        std::exception_ptr error;
+        try {
+            present(mChains[0].get());
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDone.wait(lock, [&]() { return mPending == 0U; });
+
+        if (!error) {
+            error = mError;
+        }
+        mError = nullptr;
+        lock.unlock();
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * Flushes all the chains. Must not be called during refresh().
+     */
+    void flush() override
+    {
+        for (auto &worker : mChains) {
+            worker->mChain.display->flush();
+        }
+    }
+
+    /**
+     * Returns the number of chains.
+     *
+     * @return The number of chains.
+     */
+    unsigned int getChainCnt() const
+    {
+        return static_cast<unsigned int>(mChains.size());
+    }
+
+    /**
+     * Clears the screen.
+     */
+    void clear() override
+    {
+        mBuffer.clear();
+    }
+
+    /**
+     * Modifies pixel at the given coordinates. Coordinates are zero based.
+     *
+     * @param[in] x     The x coordinate of a pixel.
+     * @param[in] y     The y coordinate of a pixel.
+     * @param[in] pixel True to turn on the pixel, false to turn it off.
+     */
+    void putPixel(unsigned int x, unsigned int y, bool pixel) override
+    {
+        mBuffer.putBit(x, y, pixel);
+    }
+
+    /**
+     * Turns on pixel at given coordinates. Coordinates are zero based.
+     *
+     * @param[in] x The x coordinate of a pixel.
+     * @param[in] y The y coordinate of a pixel.
+     */
+    void setPixel(unsigned int x, unsigned int y) override
+    {
+        mBuffer.putBit(x, y, true);
+    }
+
+    /**
+     * Turns off pixel at given coordinates. Coordinates are zero based.
+     *
+     * @param[in] x The x coordinate of a pixel.
+     * @param[in] y The y coordinate of a pixel.
+     */
+    void resetPixel(unsigned int x, unsigned int y) override
+    {
+        mBuffer.putBit(x, y, false);
+    }
+
+    /**
+     * Sets the column of pixels at the given coordinate.
+     *
+     * @param[in] x      The X coordinate of the column.
+     * @param[in] column The column of pixels, packed in a byte.
+     */
+    void putColumn(unsigned int x, uint8_t column) override
+    {
+        mBuffer.putColumn(x, column);
+    }
+
+    /**
+     * Sets consecutive columns of pixels, starting at the given coordinate.
+     *
+     * @param[in] x       The X coordinate of the first column.
+     * @param[in] columns The columns of pixels, packed in bytes.
+     * @param[in] cnt     The number of columns.
+     */
+    void blitColumns(unsigned int x,
+                     const uint8_t *columns,
+                     unsigned int cnt) override
+    {
+        mBuffer.putColumns(x, cnt, columns);
+    }
+
+    /**
+     * Inserts column of bits to the right of the display, shifting the
+     * contents of the display one pixel to the left.
+     *
+     * @param[in] column Byte holding 1x8 pixel column to be inserted.
+     *
+     * @return 1x8 pixel column that was pushed out to the left.
+     */
+    uint8_t shiftLeft(uint8_t column) override
+    {
+        return mBuffer.shiftLeft(column);
+    }
+
+    private:
+    /** A chain, with the state of its refresh thread. */
+    struct Worker {
+        Worker(const Chain &chain, unsigned int offset)
+            : mChain(chain), mOffset(offset), mColumns(chain.width)
+        {
+        }
+
+        /** The physical display. */
+        Chain mChain;
+
+        /** The X coordinate of the first column of the chain. */
+        unsigned int mOffset;
+
+        /** The part of the frame to be shown by the chain. */
+        std::vector<uint8_t> mColumns;
+
+        /** The last frame shown by the chain. */
+        unsigned long long mGeneration = 0U;
+
+        /** The refresh thread, none for the first chain. */
+        std::thread mThread;
+    };
+
+    /**
+     * Returns the width of all the chains together, throwing if there are
+     * no chains or if a chain is not 8 pixels high.
+     */
+    static unsigned int totalWidth(const std::vector<Chain> &chains)
+    {
+        if (chains.empty()) {
+            throw std::invalid_argument("Composite display has no chains");
+        }
+
+        auto width = 0U;
+        for (const auto &chain : chains) {
+            if (chain.display->getHeight() != Util::ScreenBuffer::kHeight) {
+                throw std::invalid_argument(
+                    "Composite display only supports 8 pixels high chains");
+            }
+
+            width += chain.width;
+        }
+
+        return width;
+    }
+
+    /**
+     * Stops the refresh threads started so far, waiting for them to end.
+     */
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+
+        mStart.notify_all();
+        for (auto &worker : mChains) {
+            if (worker->mThread.joinable()) {
+                worker->mThread.join();
+            }
+        }
+    }
+
+    /**
+     * Shows the part of the frame on the chain.
+     *
+     * @param[in] worker The chain.
+     */
+    static void present(Worker *worker)
+    {
+        auto &chain = worker->mChain;
+        chain.display->blitColumns(0U, worker->mColumns.data(), chain.width);
+        chain.display->refresh();
+    }
+
+    /**
+     * Body of a refresh thread, shows each new frame on the chain until
+     * stopped.
+     *
+     * @param[in] worker The chain.
+     */
+    void run(Worker *worker)
+    {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mStart.wait(lock, [&]() {
+                    return mGeneration != worker->mGeneration || mStop;
+                });
+
+                if (mStop) {
+                    return;
+                }
+                worker->mGeneration = mGeneration;
+            }
+
+            std::exception_ptr error;
+            try {
+                present(worker);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (error && !mError) {
+                    mError = error;
+                }
+                mPending--;
+            }
+            mDone.notify_one();
+        }
+    }
+
+    /** The buffer spanning all the chains. */
+    Util::ScreenBuffer mBuffer;
+
+    /** The chains, from left to right. */
+    std::vector<std::unique_ptr<Worker>> mChains;
+
+    /** Guards the frame hand-off to the refresh threads. */
+    std::mutex mMutex;
+
+    /** Signalled when a frame is to be shown or the threads should stop. */
+    std::condition_variable mStart;
+
+    /** Signalled when a refresh thread has shown the frame. */
+    std::condition_variable mDone;
+
+    /** Number of the frame to be shown. */
+    unsigned long long mGeneration = 0U;
+
+    /** Number of refresh threads still showing the frame. */
+    unsigned int mPending = 0U;
+
+    /** The first error raised by a refresh thread during the frame. */
+    std::exception_ptr mError;
+
+    /** True if the refresh threads should stop. */
+    bool mStop = false;
+};
+
+} // namespace Display
+
+} // namespace Device
@@ -27,11 +27,30 @@ class DisplayBase
      */
     virtual void refresh() = 0;
 
+    /**
+     * Makes sure the display shows the last refreshed content, for displays
+     * that may hold frames back, eg. queue them or skip some of them. Called
+     * once the content is not going to change for a while.
+     */
+    virtual void flush()
+    {
+    }
+
     /**
      * Clears the content of the display.
      */
     virtual void clear() = 0;
 
+    /**
+     * Returns the height of the display.
+     *
+     * @return The height, in pixels.
+     */
+    virtual unsigned int getHeight() const
+    {
+        return 8U;
+    }
+
     /**
      * Sets the pixel to the given value.
      *
@@ -57,6 +76,37 @@ class DisplayBase
      */
     virtual void resetPixel(unsigned int x, unsigned int y) = 0;
 
+    /**
+     * Sets the column of pixels at the given coordinate.
+     *
+     * @param[in] x      The X coordinate of the column.
+     * @param[in] column The column of pixels, bit N holding the pixel of
+     *                   the Nth row.
+     */
+    virtual void putColumn(unsigned int x, uint8_t column)
+    {
+        for (auto y = 0U; y < 8U; y++) {
+            putPixel(x, y, ((column >> y) & 0x1U) != 0U);
+        }
+    }
+
+    /**
+     * Sets consecutive columns of pixels, starting at the given coordinate.
+     * Implementations should override this method, as the default one
+     * falls back to setting pixel by pixel.
+     *
+     * @param[in] x       The X coordinate of the first column.
+     * @param[in] columns The columns of pixels, @see putColumn().
+     * @param[in] cnt     The number of columns.
+     */
+    virtual void
+    blitColumns(unsigned int x, const uint8_t *columns, unsigned int cnt)
+    {
+        for (auto i = 0U; i < cnt; i++) {
+            putColumn(x + i, columns[i]);
+        }
+    }
+
     /**
      * Shifts the contents of the screen one column to the left.
      *
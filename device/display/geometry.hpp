@@ -0,0 +1,339 @@
+#pragma once
+
+#include <cinttypes>
+#include <stdexcept>
+#include <vector>
+
+#include "util/bitblit.hpp"
+#include "util/screenbuffer.hpp"
+
+namespace Device
+{
+
+namespace Display
+{
+
+/**
+ * Describes the physical placement of the 8x8 modules of a MAX7219 chain,
+ * and maps the screen buffer onto the rows the drivers expect.
+ *
+ * The modules form a grid, each covering 8x8 pixels of the screen buffer,
+ * and may be rotated or mirrored. The order of the modules is the order of
+ * the chain: module 0 is the one connected to the bus master.
+ *
+ * The native orientation of a module is that of a module in the default,
+ * single row arrangement: bit N of digit register D shows the Nth pixel
+ * from the left, in the (7 - D)th row from the top.
+ *
+ * The mapping is compiled into a table of per-module transfers once, on
+ * construction. Each transfer gathers the eight bytes of the module from the
+ * screen buffer and reorients them with at most three word-wide 8x8 matrix
+ * kernels (mirror, flip, transpose), so that mapping a frame costs a few
+ * operations per module regardless of the orientation.
+ */
+class Geometry
+{
+    public:
+    /** Clockwise rotation of a module, relative to its native orientation. */
+    enum class Rotation {
+        none,
+        clockwise90,
+        clockwise180,
+        clockwise270,
+    };
+
+    /** Order in which the chain runs through a grid of modules. */
+    enum class Wiring {
+        /** Every row of modules runs from left to right, top row first. */
+        rows,
+
+        /** Rows alternate between left to right and right to left. */
+        serpentine,
+    };
+
+    /** Placement of a single module. */
+    struct Module {
+        /** The column of the module within the grid. */
+        unsigned int column;
+
+        /** The row of the module within the grid. */
+        unsigned int row;
+
+        /** The rotation of the module. */
+        Rotation rotation;
+
+        /** True if the module is mirrored horizontally, before rotation. */
+        bool mirrored;
+    };
+
+    /** Native coordinates of a pixel. */
+    struct Location {
+        /** The index of the module within the chain. */
+        unsigned int module;
+
+        /** The zero based index of the digit register. */
+        unsigned int digit;
+
+        /** The bit within the digit register. */
+        unsigned int bit;
+    };
+
+    /**
+     * Constructs the geometry from explicitly placed modules.
+     *
+     * @param[in] modules The modules, in the order of the chain. Each grid
+     *                    cell must hold at most one module.
+     */
+    explicit Geometry(const std::vector<Module> &modules) : mModules(modules)
+    {
+        if (modules.empty()) {
+            throw std::invalid_argument("The geometry has no modules");
+        }
+
+        for (const auto &module : modules) {
+            mColumns = module.column >= mColumns ? module.column + 1U
+                                                 : mColumns;
+            mRows    = module.row >= mRows ? module.row + 1U : mRows;
+        }
+
+        std::vector<bool> taken(mColumns * mRows, false);
+        for (const auto &module : modules) {
+            auto cell = module.row * mColumns + module.column;
+            if (taken[cell]) {
+                throw std::invalid_argument("The modules overlap");
+            }
+            taken[cell] = true;
+
+            mTransfers.push_back(compile(module));
+        }
+    }
+
+    /**
+     * Returns the geometry of a single row of modules in native orientation,
+     * chained from left to right.
+     *
+     * @param[in] width The width of the row, in pixels.
+     *
+     * @return The geometry.
+     */
+    static Geometry strip(unsigned int width)
+    {
+        if (width == 0U || width % 8U != 0U) {
+            throw std::invalid_argument("The width must be divisible by 8");
+        }
+
+        return grid(width / 8U, 1U);
+    }
+
+    /**
+     * Returns the geometry of a grid of equally oriented modules, chained
+     * starting at the top left one.
+     *
+     * @param[in] columns  The number of modules in a row.
+     * @param[in] rows     The number of rows of modules.
+     * @param[in] wiring   The order the chain runs through the grid.
+     * @param[in] rotation The rotation of the modules.
+     * @param[in] mirrored True if the modules are mirrored.
+     *
+     * @return The geometry.
+     */
+    static Geometry grid(unsigned int columns,
+                         unsigned int rows,
+                         Wiring wiring     = Wiring::rows,
+                         Rotation rotation = Rotation::none,
+                         bool mirrored     = false)
+    {
+        std::vector<Module> modules;
+
+        for (auto row = 0U; row < rows; row++) {
+            for (auto i = 0U; i < columns; i++) {
+                bool reversed = wiring == Wiring::serpentine && row % 2U != 0U;
+                auto column   = reversed ? columns - 1U - i : i;
+                modules.push_back({column, row, rotation, mirrored});
+            }
+        }
+
+        return Geometry(modules);
+    }
+
+    /**
+     * Returns the width of the area covered by the modules.
+     *
+     * @return The width, in pixels.
+     */
+    unsigned int getWidth() const
+    {
+        return mColumns * 8U;
+    }
+
+    /**
+     * Returns the height of the area covered by the modules.
+     *
+     * @return The height, in pixels.
+     */
+    unsigned int getHeight() const
+    {
+        return mRows * 8U;
+    }
+
+    /**
+     * Returns the number of modules in the chain.
+     *
+     * @return The number of modules.
+     */
+    unsigned int getModuleCnt() const
+    {
+        return static_cast<unsigned int>(mModules.size());
+    }
+
+    /**
+     * Returns the placement of a module.
+     *
+     * @param[in] module The index of the module within the chain.
+     *
+     * @return The placement.
+     */
+    const Module &getModule(unsigned int module) const
+    {
+        return mModules[module];
+    }
+
+    /**
+     * Maps the content of the screen buffer onto the digit registers of the
+     * modules.
+     *
+     * @param[in]  buffer The screen buffer, at least getWidth() wide and
+     *                    getHeight() high.
+     * @param[out] rows   Receives 8 * getModuleCnt() bytes, row by row: byte
+     *                    (7 - D) * getModuleCnt() + M holds digit register D
+     *                    of module M.
+     */
+    void map(const Util::ScreenBuffer &buffer, uint8_t *rows) const
+    {
+        using Word     = Util::BitBlit::Word;
+        auto moduleCnt = getModuleCnt();
+
+        for (auto m = 0U; m < moduleCnt; m++) {
+            const auto &transfer = mTransfers[m];
+            Word block           = 0U;
+
+            for (auto y = 0U; y < 8U; y++) {
+                auto row = buffer.raw(transfer.y + y, transfer.segment);
+                block |= Word{row} << (y * 8U);
+            }
+
+            if (transfer.mirror) {
+                block = Util::BitBlit::mirror8x8(block);
+            }
+            if (transfer.flip) {
+                block = Util::BitBlit::flip8x8(block);
+            }
+            if (transfer.transpose) {
+                block = Util::BitBlit::transpose8x8(block);
+            }
+
+            for (auto v = 0U; v < 8U; v++) {
+                rows[v * moduleCnt + m] =
+                    static_cast<uint8_t>(block >> (v * 8U));
+            }
+        }
+    }
+
+    /**
+     * Finds the native coordinates of a pixel of the screen buffer. This is
+     * the per-pixel definition of the mapping, not meant for the refresh.
+     *
+     * @param[in] x The X coordinate of the pixel.
+     * @param[in] y The Y coordinate of the pixel.
+     *
+     * @return The coordinates, with the module set to getModuleCnt() if no
+     *         module covers the pixel.
+     */
+    Location locate(unsigned int x, unsigned int y) const
+    {
+        for (auto m = 0U; m < getModuleCnt(); m++) {
+            const auto &module = mModules[m];
+            if (x / 8U != module.column || y / 8U != module.row) {
+                continue;
+            }
+
+            /* The position within the module, undoing the placement */
+            auto u = module.mirrored ? 7U - x % 8U : x % 8U;
+            auto v = y % 8U;
+
+            for (auto r = 0U; r < static_cast<unsigned int>(module.rotation);
+                 r++) {
+                auto t = u;
+                u      = v;
+                v      = 7U - t;
+            }
+
+            return {m, 7U - v, u};
+        }
+
+        return {getModuleCnt(), 0U, 0U};
+    }
+
+    private:
+    /** The compiled transfer of a single module. */
+    struct Transfer {
+        /** The byte of the screen buffer rows holding the module. */
+        unsigned int segment;
+
+        /** The first screen buffer row of the module. */
+        unsigned int y;
+
+        /** True to reverse the pixels of each row. */
+        bool mirror;
+
+        /** True to reverse the order of the rows. */
+        bool flip;
+
+        /** True to swap rows and columns, done last. */
+        bool transpose;
+    };
+
+    /**
+     * Compiles the transfer of a module.
+     *
+     * Taking the block of the module with byte N holding its Nth row, the
+     * rotations are expressed by the kernels as follows: 90 degrees is
+     * mirror and transpose, 180 degrees is mirror and flip, and 270
+     * degrees is flip and transpose. Mirroring the module mirrors the
+     * block before that, which cancels out with the rotation's mirror.
+     */
+    static Transfer compile(const Module &module)
+    {
+        bool quarter = module.rotation == Rotation::clockwise90 ||
+                       module.rotation == Rotation::clockwise270;
+        bool mirror  = module.rotation == Rotation::clockwise90 ||
+                      module.rotation == Rotation::clockwise180;
+        bool flip    = module.rotation == Rotation::clockwise180 ||
+                    module.rotation == Rotation::clockwise270;
+
+        Transfer transfer;
+        transfer.segment   = module.column;
+        transfer.y         = module.row * 8U;
+        transfer.mirror    = mirror != module.mirrored;
+        transfer.flip      = flip;
+        transfer.transpose = quarter;
+
+        return transfer;
+    }
+
+    /** The modules, in the order of the chain. */
+    std::vector<Module> mModules;
+
+    /** The compiled transfers, in the order of the chain. */
+    std::vector<Transfer> mTransfers;
+
+    /** Number of columns of the grid. */
+    unsigned int mColumns = 0U;
+
+    /** Number of rows of the grid. */
+    unsigned int mRows = 0U;
+};
+
+} // namespace Display
+
+} // namespace Device
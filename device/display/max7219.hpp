@@ -1,12 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <vector>
 
 #include "device/spi/spi-base.hpp"
 #include "display-base.hpp"
+#include "geometry.hpp"
+#include "util/metrics.hpp"
 #include "util/screenbuffer.hpp"
+#include "util/terminal-renderer.hpp"
 
 namespace Device
 {
@@ -17,49 +22,197 @@ namespace Display
 /**
  * The class provides the interface to the MAX7219 driven 8x8 led dot matrix
  * display.
- * Any number of daisy chained displays is supported, assuming that the
+ * Any number of daisy chained displays is supported. By default, the
  * additional displays only increase the available width (ie. are added to the
- * right). Any actual screen geometry (the physical placement of the 8x8
- * segments) is not handled by this class. Currently, only left-to-right
- * arrangement of the displays is supported.
+ * right). Other arrangements, such as several rows of displays, rotated or
+ * mirrored displays, or serpentine wiring, are described by a Geometry,
+ * which maps the screen buffer onto the digit registers of the chain.
  */
 class Max7219 : public Device::Display::DisplayBase
 {
     public:
+    /**
+     * Selects how the screen buffer is transferred to the display chain.
+     */
+    enum class RefreshMode {
+        /**
+         * Every (row, segment) pair is sent as a separate SPI transaction,
+         * with all other segments receiving a NoOp. This results in
+         * 8 * N transactions of 2 * N bytes per frame, for N segments.
+         */
+        perSegment,
+
+        /**
+         * Every row is sent to all cascaded segments in a single SPI
+         * transaction, resulting in 8 transactions of 2 * N bytes per
+         * frame.
+         */
+        rowBatched,
+    };
+
     /**
      * Constructs a new display object.
      *
-     * @param[in] spi    The reference to the spi object.
-     * @param[in] width  The width of the display, in pixels.
+     * @param[in] spi          The reference to the spi object.
+     * @param[in] width        The width of the display, in pixels.
+     * @param[in] dumpToStdOut True to dump each frame to the standard output.
+     * @param[in] mode         The method used to refresh the display.
+     */
+    Max7219(Device::Spi::SpiBase &spi,
+            unsigned int width,
+            bool dumpToStdOut,
+            RefreshMode mode = RefreshMode::rowBatched)
+        : Max7219(spi, Geometry::strip(width), dumpToStdOut, mode)
+    {
+    }
+
+    /**
+     * Constructs a new display object, with the given arrangement of the
+     * displays. The screen buffer covers the area of the arrangement.
+     *
+     * @param[in] spi          The reference to the spi object.
+     * @param[in] geometry     The arrangement of the displays of the chain.
+     * @param[in] dumpToStdOut True to dump each frame to the standard output.
+     * @param[in] mode         The method used to refresh the display.
      */
-    Max7219(Device::Spi::SpiBase &spi, unsigned int width, bool dumpToStdOut)
-        : mSpi(spi), mBuffer(width), mDumpToStdOut(dumpToStdOut)
+    Max7219(Device::Spi::SpiBase &spi,
+            const Geometry &geometry,
+            bool dumpToStdOut,
+            RefreshMode mode = RefreshMode::rowBatched)
+        : mSpi(spi), mGeometry(geometry),
+          mBuffer(geometry.getWidth(), geometry.getHeight()),
+          mRows(kDigitCnt * geometry.getModuleCnt()), mMode(mode)
     {
+        if (dumpToStdOut) {
+            mTerminal = std::make_unique<Util::TerminalRenderer>();
+        }
+
         /* Prepare display for data writing */
         writeAll(Test::address, Test::off);
         writeAll(Shutdown::address, Shutdown::on);
         writeAll(Brightness::address, Brightness::lowest);
         writeAll(ScanLimit::address, ScanLimit::allDigits);
+
+        reserveFrame();
     }
 
     /**
      * Refreshes SPI interfaced dot matrix display with the data contained
-     * in the screen buffer.
+     * in the screen buffer. Only the digit registers whose content differs
+     * from the last frame sent are transmitted, unless a keyframe is due.
      */
     void refresh() override
     {
-        auto height     = Util::ScreenBuffer::kHeight;
-        auto segmentCnt = mBuffer.getSegmentCnt();
+        DOTCLOCK_METRICS_TIME(refresh);
+
+        auto segmentCnt = mGeometry.getModuleCnt();
+        bool keyframe   = isKeyframeDue();
+
+        mGeometry.map(mBuffer, mRows.data());
+        mMessages.clear();
 
-        for (uint8_t row = 1U; row <= height; row++) {
-            for (uint8_t seg = 0U; seg < segmentCnt; seg++) {
-                write(row, mBuffer.raw(height - row, seg), seg);
+        for (uint8_t row = 1U; row <= kDigitCnt; row++) {
+            auto y = kDigitCnt - row;
+
+            if (mMode == RefreshMode::rowBatched) {
+                queueRow(row, y, keyframe);
+                continue;
+            }
+
+            for (auto seg = 0U; seg < segmentCnt; seg++) {
+                if (keyframe || isDirty(y, seg)) {
+                    queue(row, native(y, seg), seg);
+                }
             }
         }
 
-        if (mDumpToStdOut) {
-            mBuffer.dump();
+        if (!mMessages.empty()) {
+            DOTCLOCK_METRICS_TIME(spiWrite);
+            mSpi.writeFrame(mMessages.data(), mMessages.size());
         }
+
+        DOTCLOCK_METRICS_ADD(spiTransactions, mMessages.size());
+        DOTCLOCK_METRICS_ADD(spiBytes, mMessages.size() * messageLength());
+        DOTCLOCK_METRICS_OBSERVE(spiTransactionsPerFrame, mMessages.size());
+        DOTCLOCK_METRICS_OBSERVE(spiBytesPerFrame,
+                                 mMessages.size() * messageLength());
+
+        updateShadow();
+
+        if (mTerminal) {
+            mTerminal->render(mBuffer);
+        }
+    }
+
+    /**
+     * Shows the content of the screen buffer on the terminal, if the frame
+     * dumped last was skipped by its throttling. The frames sent to the
+     * chain are never held back.
+     */
+    void flush() override
+    {
+        if (mTerminal && mTerminal->isPending()) {
+            mTerminal->render(mBuffer, true);
+        }
+    }
+
+    /**
+     * Changes the method used to refresh the display.
+     *
+     * @param[in] mode The new refresh mode.
+     */
+    void setRefreshMode(RefreshMode mode)
+    {
+        mMode = mode;
+        reserveFrame();
+    }
+
+    /**
+     * Returns the method used to refresh the display.
+     *
+     * @return The current refresh mode.
+     */
+    RefreshMode getRefreshMode() const
+    {
+        return mMode;
+    }
+
+    /**
+     * Returns the arrangement of the displays.
+     *
+     * @return The geometry.
+     */
+    const Geometry &getGeometry() const
+    {
+        return mGeometry;
+    }
+
+    /**
+     * @see DisplayBase::getHeight()
+     */
+    unsigned int getHeight() const override
+    {
+        return mGeometry.getHeight();
+    }
+
+    /**
+     * Sets how often the whole frame is sent regardless of the dirty state,
+     * allowing the display to recover from transmission glitches.
+     *
+     * @param[in] frames Number of refreshes between two full refreshes, or
+     *                   zero to disable periodic full refreshes.
+     */
+    void setKeyframeInterval(unsigned int frames)
+    {
+        mKeyframeInterval = frames;
+    }
+
+    /**
+     * Forces the next refresh to send the whole frame.
+     */
+    void invalidate()
+    {
+        mShadowValid = false;
     }
 
     /**
@@ -104,6 +257,31 @@ class Max7219 : public Device::Display::DisplayBase
         mBuffer.putBit(x, y, false);
     }
 
+    /**
+     * Sets the column of pixels at the given coordinate.
+     *
+     * @param[in] x      The X coordinate of the column.
+     * @param[in] column The column of pixels, packed in a byte.
+     */
+    void putColumn(unsigned int x, uint8_t column) override
+    {
+        mBuffer.putColumn(x, column);
+    }
+
+    /**
+     * Sets consecutive columns of pixels, starting at the given coordinate.
+     *
+     * @param[in] x       The X coordinate of the first column.
+     * @param[in] columns The columns of pixels, packed in bytes.
+     * @param[in] cnt     The number of columns.
+     */
+    void blitColumns(unsigned int x,
+                     const uint8_t *columns,
+                     unsigned int cnt) override
+    {
+        mBuffer.putColumns(x, cnt, columns);
+    }
+
     /**
      * Inserts column of bits to the right of the display, shifting the
      * contents of the display one pixel to the left.
@@ -130,19 +308,20 @@ class Max7219 : public Device::Display::DisplayBase
      */
     template <typename T> void writeAll(T address, T value)
     {
-        auto segmentCnt             = mBuffer.getSegmentCnt();
-        std::vector<uint8_t> buffer = {
+        auto segmentCnt               = mGeometry.getModuleCnt();
+        const uint8_t buffer[kCmdLen] = {
             static_cast<uint8_t>(address),
             static_cast<uint8_t>(value),
         };
 
         for (auto i = 0U; i < segmentCnt; i++) {
-            mSpi.write(buffer);
+            mSpi.write(buffer, kCmdLen);
         }
     }
 
     /**
-     * Writes the given value to a single display segment.
+     * Queues a message that writes the given value to a single display
+     * segment. The message is sent together with the rest of the frame.
      *
      * @tparam T      The type of the value, must be the size of a single
      * byte.
@@ -150,36 +329,229 @@ class Max7219 : public Device::Display::DisplayBase
      * @param value   The value to be written to the display register.
      * @param segment The zero based index of a display segment.
      */
-    template <typename T> void write(T address, T value, unsigned int segment)
+    template <typename T> void queue(T address, T value, unsigned int segment)
     {
         /* Each segment expects 2 bytes long command */
-        auto segmentCnt = mBuffer.getSegmentCnt();
-        std::vector<uint8_t> buffer(segmentCnt * kCmdLen,
-                                    static_cast<uint8_t>(NoOp::skip));
+        auto segmentCnt = mGeometry.getModuleCnt();
+        uint8_t *buffer = nextMessage();
+
+        std::fill(buffer,
+                  buffer + segmentCnt * kCmdLen,
+                  static_cast<uint8_t>(NoOp::skip));
 
         auto ind      = (segmentCnt - segment - 1U) * kCmdLen;
         buffer[ind++] = static_cast<uint8_t>(address);
         buffer[ind]   = static_cast<uint8_t>(value);
 
-        mSpi.write(buffer);
+        commitMessage(buffer);
+    }
+
+    /**
+     * Queues a message that writes a single row of the screen buffer to all
+     * display segments in one transaction. Segments whose content has not
+     * changed receive a NoOp. If no segment has changed, nothing is queued.
+     *
+     * @param address The digit register address of the row.
+     * @param y       The row of the mapped frame holding the data.
+     * @param full    True to send all segments, regardless of their state.
+     */
+    void queueRow(uint8_t address, unsigned int y, bool full)
+    {
+        auto segmentCnt = mGeometry.getModuleCnt();
+        uint8_t *buffer = nextMessage();
+        bool dirty      = false;
+
+        std::fill(buffer,
+                  buffer + segmentCnt * kCmdLen,
+                  static_cast<uint8_t>(NoOp::skip));
+
+        /* The first command sent is shifted through to the last segment */
+        for (auto seg = 0U; seg < segmentCnt; seg++) {
+            if (full || isDirty(y, seg)) {
+                auto ind      = (segmentCnt - seg - 1U) * kCmdLen;
+                buffer[ind++] = address;
+                buffer[ind]   = native(y, seg);
+                dirty         = true;
+            }
+        }
+
+        if (dirty) {
+            commitMessage(buffer);
+        }
+    }
+
+    /**
+     * Preallocates the buffers needed to refresh the whole display in the
+     * current refresh mode, so that refresh() does not allocate memory.
+     */
+    void reserveFrame()
+    {
+        auto messageCnt = kDigitCnt;
+        if (mMode == RefreshMode::perSegment) {
+            messageCnt *= mGeometry.getModuleCnt();
+        }
+
+        mFrameData.resize(messageCnt * mGeometry.getModuleCnt() * kCmdLen);
+        mMessages.reserve(messageCnt);
+        mShadow.assign(shadowSize(), 0U);
+        mShadowValid = false;
+    }
+
+    /**
+     * Returns the storage for the next message of the frame. The storage
+     * is large enough to hold a command for every segment.
+     *
+     * @return Pointer to the message storage.
+     */
+    uint8_t *nextMessage()
+    {
+        return &mFrameData[mMessages.size() * messageLength()];
+    }
+
+    /**
+     * Adds the message obtained by nextMessage() to the frame.
+     *
+     * @param buffer The message storage.
+     */
+    void commitMessage(const uint8_t *buffer)
+    {
+        mMessages.push_back({buffer, messageLength()});
+    }
+
+    /**
+     * Returns the length of a message holding a command for every segment.
+     *
+     * @return The length of the message, in bytes.
+     */
+    std::size_t messageLength()
+    {
+        return mGeometry.getModuleCnt() * kCmdLen;
+    }
+
+    /**
+     * Returns the content of a row of a segment, as mapped for the display.
+     *
+     * @param y       The row of the mapped frame.
+     * @param segment The zero based index of a display segment.
+     *
+     * @return The value of the digit register showing the row.
+     */
+    uint8_t native(unsigned int y, unsigned int segment) const
+    {
+        return mRows[y * mGeometry.getModuleCnt() + segment];
+    }
+
+    /**
+     * Checks if the segment of a row differs from what is being shown on
+     * the display.
+     *
+     * @param y       The row of the mapped frame.
+     * @param segment The zero based index of a display segment.
+     *
+     * @retval true  The segment needs to be sent to the display.
+     * @retval false The display already shows the segment content.
+     */
+    bool isDirty(unsigned int y, unsigned int segment)
+    {
+        auto index = y * mGeometry.getModuleCnt() + segment;
+        return mShadow[index] != mRows[index];
+    }
+
+    /**
+     * Decides whether the next refresh needs to send the whole frame.
+     *
+     * @retval true  The whole frame should be sent.
+     * @retval false Only the changed segments should be sent.
+     */
+    bool isKeyframeDue()
+    {
+        if (!mShadowValid || mShadow.size() != shadowSize()) {
+            mShadow.assign(shadowSize(), 0U);
+            mFramesSinceKeyframe = 0U;
+            return true;
+        }
+
+        if (mKeyframeInterval != 0U &&
+            ++mFramesSinceKeyframe >= mKeyframeInterval) {
+            mFramesSinceKeyframe = 0U;
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * Copies the mapped frame to the shadow copy, after it has been sent to
+     * the display.
+     */
+    void updateShadow()
+    {
+        std::copy(mRows.begin(), mRows.end(), mShadow.begin());
+        mShadowValid = true;
+    }
+
+    /**
+     * Returns the size of the shadow copy needed for the current screen.
+     *
+     * @return Number of bytes in a frame.
+     */
+    std::size_t shadowSize()
+    {
+        return kDigitCnt * mGeometry.getModuleCnt();
     }
 
     /** Reference to the SPI device. */
     Device::Spi::SpiBase &mSpi;
 
+    /** Storage of all the messages of the frame being refreshed. */
+    std::vector<uint8_t> mFrameData;
+
+    /** Messages queued for the frame being refreshed. */
+    std::vector<Device::Spi::Message> mMessages;
+
     /**
      * The length of an SPI command for a single segment (address + value
      * pair).
      */
     static const unsigned int kCmdLen = 2U;
 
+    /** Number of digit registers, ie. rows of a segment. */
+    static const unsigned int kDigitCnt = 8U;
+
+    /** The arrangement of the displays. */
+    Geometry mGeometry;
+
     /**
      * Screen buffer.
      */
     Util::ScreenBuffer mBuffer;
 
-    /** True if output should be dumped to the standard output */
-    bool mDumpToStdOut = false;
+    /**
+     * The frame mapped for the display, stored row by row, one byte per
+     * segment.
+     */
+    std::vector<uint8_t> mRows;
+
+    /** Shows the frames on the standard output, if requested. */
+    std::unique_ptr<Util::TerminalRenderer> mTerminal;
+
+    /** The method used to refresh the display. */
+    RefreshMode mMode = RefreshMode::rowBatched;
+
+    /**
+     * Copy of the frame last sent to the display, stored row by row, one
+     * byte per segment.
+     */
+    std::vector<uint8_t> mShadow;
+
+    /** False if the display content is unknown. */
+    bool mShadowValid = false;
+
+    /** Number of refreshes between two full refreshes, zero if disabled. */
+    unsigned int mKeyframeInterval = 0U;
+
+    /** Number of refreshes since the last full refresh. */
+    unsigned int mFramesSinceKeyframe = 0U;
 
     /** MAX7219 specific register constants, according to the data sheet. */
 
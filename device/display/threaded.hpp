@@ -0,0 +1,351 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "display-base.hpp"
+#include "util/metrics.hpp"
+#include "util/screenbuffer.hpp"
+#include "util/spsc-ring.hpp"
+
+namespace Device
+{
+
+namespace Display
+{
+
+/**
+ * Display that decouples rendering from the output to the physical display.
+ *
+ * Drawing operations are applied to a local screen buffer, on the thread of
+ * the caller. Each refresh() queues a snapshot of the buffer to a lock-free
+ * single-producer/single-consumer ring, and an output thread drains the ring
+ * to the physical display. A slow bus thus no longer delays rendering, as
+ * long as the ring has free slots, and a slow renderer does not hold the
+ * bus.
+ *
+ * When the ring is full, refresh() waits for the output thread, so that no
+ * frame is dropped; such waits are counted as stalls. Errors raised by the
+ * physical display are rethrown by the next refresh().
+ *
+ * The frames are queued as columns of 8 pixels, so only physical displays
+ * 8 pixels high, a single row of modules, are supported.
+ */
+class Threaded : public Device::Display::DisplayBase
+{
+    public:
+    /** Pipeline statistics. */
+    struct Stats {
+        /** Number of frames queued by refresh(). */
+        unsigned long long queued = 0U;
+
+        /** Number of frames sent to the physical display. */
+        unsigned long long output = 0U;
+
+        /** Number of refresh() calls that had to wait for a free slot. */
+        unsigned long long stalls = 0U;
+
+        /** The largest number of frames queued at once. */
+        unsigned long long maxDepth = 0U;
+    };
+
+    /**
+     * Constructs the display and starts the output thread.
+     *
+     * @param[in] target The physical display, only accessed from the output
+     *                   thread from now on. Must be 8 pixels high.
+     * @param[in] width  The width of the display, in pixels.
+     * @param[in] depth  The maximal number of frames queued.
+     */
+    Threaded(Device::Display::DisplayBase *target,
+             unsigned int width,
+             unsigned int depth = 4U)
+        : mTarget(target), mBuffer(width),
+          mRing(depth, std::vector<uint8_t>(width)), mWidth(width)
+    {
+        if (target->getHeight() != Util::ScreenBuffer::kHeight) {
+            throw std::invalid_argument(
+                "Threaded display only supports 8 pixels high displays");
+        }
+
+        mThread = std::thread([this]() { output(); });
+    }
+
+    /**
+     * Sends the queued frames to the physical display and stops the output
+     * thread.
+     */
+    virtual ~Threaded() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+
+        mReady.notify_one();
+        mThread.join();
+    }
+
+    Threaded(const Threaded &) = delete;
+    Threaded &operator=(const Threaded &) = delete;
+
+    /**
+     * Queues the content of the screen buffer to be shown on the physical
+     * display.
+     */
+    void refresh() override
+    {
+        auto *frame = mRing.acquire();
+
+        if (frame == nullptr) {
+            mStalls++;
+            DOTCLOCK_METRICS_ADD(pipelineStalls, 1U);
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            mSpace.wait(lock, [&]() {
+                frame = mRing.acquire();
+                return frame != nullptr || mError;
+            });
+        }
+
+        rethrow();
+
+        mBuffer.getColumns(0U, mWidth, frame->data());
+        mRing.publish();
+        mQueued++;
+
+        auto depth = static_cast<unsigned long long>(mRing.depth());
+        if (depth > mMaxDepth) {
+            mMaxDepth = depth;
+        }
+        DOTCLOCK_METRICS_OBSERVE(pipelineDepth, depth);
+
+        /* Taking the lock ensures the output thread does not miss the wake */
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+        }
+        mReady.notify_one();
+    }
+
+    /**
+     * Waits until all queued frames have been sent to the physical display,
+     * then flushes it. The output thread is idle until the next refresh(),
+     * so the physical display can be accessed from here.
+     */
+    void flush() override
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mSpace.wait(lock, [&]() { return mOutput == mQueued || mError; });
+        lock.unlock();
+
+        rethrow();
+
+        mTarget->flush();
+    }
+
+    /**
+     * Returns the pipeline statistics.
+     *
+     * @return A snapshot of the statistics.
+     */
+    Stats getStats() const
+    {
+        Stats stats;
+        stats.queued   = mQueued;
+        stats.output   = mOutput;
+        stats.stalls   = mStalls;
+        stats.maxDepth = mMaxDepth;
+
+        return stats;
+    }
+
+    /**
+     * Returns the number of frames waiting to be sent.
+     *
+     * @return The queue depth.
+     */
+    unsigned int getDepth() const
+    {
+        return static_cast<unsigned int>(mRing.depth());
+    }
+
+    /**
+     * Clears the screen.
+     */
+    void clear() override
+    {
+        mBuffer.clear();
+    }
+
+    /**
+     * Modifies pixel at the given coordinates. Coordinates are zero based.
+     *
+     * @param[in] x     The x coordinate of a pixel.
+     * @param[in] y     The y coordinate of a pixel.
+     * @param[in] pixel True to turn on the pixel, false to turn it off.
+     */
+    void putPixel(unsigned int x, unsigned int y, bool pixel) override
+    {
+        mBuffer.putBit(x, y, pixel);
+    }
+
+    /**
+     * Turns on pixel at given coordinates. Coordinates are zero based.
+     *
+     * @param[in] x The x coordinate of a pixel.
+     * @param[in] y The y coordinate of a pixel.
+     */
+    void setPixel(unsigned int x, unsigned int y) override
+    {
+        mBuffer.putBit(x, y, true);
+    }
+
+    /**
+     * Turns off pixel at given coordinates. Coordinates are zero based.
+     *
+     * @param[in] x The x coordinate of a pixel.
+     * @param[in] y The y coordinate of a pixel.
+     */
+    void resetPixel(unsigned int x, unsigned int y) override
+    {
+        mBuffer.putBit(x, y, false);
+    }
+
+    /**
+     * Sets the column of pixels at the given coordinate.
+     *
+     * @param[in] x      The X coordinate of the column.
+     * @param[in] column The column of pixels, packed in a byte.
+     */
+    void putColumn(unsigned int x, uint8_t column) override
+    {
+        mBuffer.putColumn(x, column);
+    }
+
+    /**
+     * Sets consecutive columns of pixels, starting at the given coordinate.
+     *
+     * @param[in] x       The X coordinate of the first column.
+     * @param[in] columns The columns of pixels, packed in bytes.
+     * @param[in] cnt     The number of columns.
+     */
+    void blitColumns(unsigned int x,
+                     const uint8_t *columns,
+                     unsigned int cnt) override
+    {
+        mBuffer.putColumns(x, cnt, columns);
+    }
+
+    /**
+     * Inserts column of bits to the right of the display, shifting the
+     * contents of the display one pixel to the left.
+     *
+     * @param[in] column Byte holding 1x8 pixel column to be inserted.
+     *
+     * @return 1x8 pixel column that was pushed out to the left.
+     */
+    uint8_t shiftLeft(uint8_t column) override
+    {
+        return mBuffer.shiftLeft(column);
+    }
+
+    private:
+    /**
+     * Body of the output thread, sends the queued frames to the physical
+     * display until stopped.
+     */
+    void output()
+    {
+        for (;;) {
+            std::vector<uint8_t> *frame = nullptr;
+
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mReady.wait(lock, [&]() {
+                    frame = mRing.front();
+                    return frame != nullptr || mStop;
+                });
+            }
+
+            if (frame == nullptr) {
+                return;
+            }
+
+            try {
+                mTarget->blitColumns(0U, frame->data(), mWidth);
+                mTarget->refresh();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mError = std::current_exception();
+            }
+
+            mRing.pop();
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mOutput++;
+            }
+            mSpace.notify_one();
+
+            if (mError) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * Rethrows the error raised by the physical display, if any.
+     */
+    void rethrow()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mError) {
+            std::rethrow_exception(mError);
+        }
+    }
+
+    /** The physical display. */
+    Device::Display::DisplayBase *mTarget;
+
+    /** The buffer drawn to by the rendering thread. */
+    Util::ScreenBuffer mBuffer;
+
+    /** Frames waiting to be sent, as columns of pixels. */
+    Util::SpscRing<std::vector<uint8_t>> mRing;
+
+    /** The width of the display, in pixels. */
+    unsigned int mWidth;
+
+    /** Guards the waits for frames and free slots, and the error. */
+    std::mutex mMutex;
+
+    /** Signalled when a frame is queued or the thread should stop. */
+    std::condition_variable mReady;
+
+    /** Signalled when a frame has been sent. */
+    std::condition_variable mSpace;
+
+    /** True if the output thread should stop once the ring is drained. */
+    bool mStop = false;
+
+    /** The error raised by the physical display. */
+    std::exception_ptr mError;
+
+    /** Statistics, see Stats. */
+    std::atomic<unsigned long long> mQueued{0U};
+    std::atomic<unsigned long long> mOutput{0U};
+    std::atomic<unsigned long long> mStalls{0U};
+    std::atomic<unsigned long long> mMaxDepth{0U};
+
+    /** The output thread, started last. */
+    std::thread mThread;
+};
+
+} // namespace Display
+
+} // namespace Device
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include "spi-base.hpp"
+#include "util/hash.hpp"
+
+namespace Device
+{
+
+namespace Spi
+{
+
+/**
+ * SPI device emulating a chain of cascaded MAX7219 drivers, each driving an
+ * 8x8 led dot matrix segment. The bytes written are shifted through the
+ * 16-bit shift registers of the chain, and the command held by each driver
+ * is executed when the chip select is released at the end of a message.
+ *
+ * Segment 0 is the driver connected to the bus master, ie. the one receiving
+ * the last command of a message, and shows the leftmost 8 pixels.
+ *
+ * Besides the emulated display content, the traffic is accounted, so that
+ * the bus efficiency of the refresh code can be measured.
+ */
+class Max7219Emulator : public Device::Spi::SpiBase
+{
+    public:
+    /** Traffic statistics. */
+    struct Stats {
+        /** Number of bytes shifted into the chain. */
+        unsigned long long bytes = 0U;
+
+        /** Number of messages, ie. chip select pulses. */
+        unsigned long long messages = 0U;
+
+        /** Number of NoOp commands executed by the drivers. */
+        unsigned long long noOps = 0U;
+
+        /** Number of register writes that changed the register value. */
+        unsigned long long writes = 0U;
+
+        /** Number of register writes of the value already held. */
+        unsigned long long redundantWrites = 0U;
+    };
+
+    /** Length of a single command (address + value pair), in bytes. */
+    static const unsigned int kCmdLen = 2U;
+
+    /**
+     * Constructs the emulated chain, with all drivers in the power-up state.
+     *
+     * @param[in] segmentCnt The number of drivers in the chain.
+     */
+    explicit Max7219Emulator(unsigned int segmentCnt)
+        : mRegisters(segmentCnt), mShift(segmentCnt * kCmdLen, 0U),
+          mNextShift(segmentCnt * kCmdLen, 0U)
+    {
+        for (auto &registers : mRegisters) {
+            registers.fill(0U);
+        }
+    }
+
+    /**
+     * Shifts the buffer into the chain and latches the commands.
+     *
+     * @param[in] buffer The buffer to be sent.
+     * @param[in] length The number of bytes in the buffer.
+     */
+    virtual void write(const uint8_t *buffer, std::size_t length) override
+    {
+        /*
+         * Position p of the chain holds the p-th byte counting from the most
+         * recently shifted one. Bytes shifted out of the last driver are
+         * lost.
+         */
+        for (std::size_t p = 0U; p < mShift.size(); p++) {
+            mNextShift[p] =
+                p < length ? buffer[length - 1U - p] : mShift[p - length];
+        }
+        mShift.swap(mNextShift);
+
+        mStats.bytes += length;
+        mStats.messages++;
+
+        for (auto seg = 0U; seg < mRegisters.size(); seg++) {
+            execute(seg, mShift[seg * kCmdLen + 1U], mShift[seg * kCmdLen]);
+        }
+    }
+
+    /**
+     * Returns the number of drivers in the chain.
+     *
+     * @return The number of segments.
+     */
+    unsigned int getSegmentCnt() const
+    {
+        return static_cast<unsigned int>(mRegisters.size());
+    }
+
+    /**
+     * Returns the content of a digit register, ie. a single row of a
+     * segment.
+     *
+     * @param[in] segment The zero based index of a display segment.
+     * @param[in] digit   The zero based index of the digit register.
+     *
+     * @return The register value.
+     */
+    uint8_t getDigit(unsigned int segment, unsigned int digit) const
+    {
+        return mRegisters[segment][Register::digit0 + digit];
+    }
+
+    /**
+     * Returns the pixels shown in a row of a segment, taking into account
+     * the shutdown, display test and scan limit registers. Bit N holds the
+     * Nth pixel from the left.
+     *
+     * @param[in] segment The zero based index of a display segment.
+     * @param[in] y       The zero based y coordinate of the row.
+     *
+     * @return The lit pixels.
+     */
+    uint8_t getRow(unsigned int segment, unsigned int y) const
+    {
+        const auto &registers = mRegisters[segment];
+        auto digit            = kDigitCnt - 1U - y;
+
+        if ((registers[Register::displayTest] & 0x1U) != 0U) {
+            return 0xFFU;
+        }
+
+        if ((registers[Register::shutdown] & 0x1U) == 0U ||
+            digit > (registers[Register::scanLimit] & 0x7U)) {
+            return 0U;
+        }
+
+        return registers[Register::digit0 + digit];
+    }
+
+    /**
+     * Checks if the pixel is lit, taking into account the shutdown, display
+     * test and scan limit registers. Coordinates are zero based, and match
+     * the ones of the Max7219 display class.
+     *
+     * @param[in] x The x coordinate of a pixel.
+     * @param[in] y The y coordinate of a pixel.
+     *
+     * @return True if the pixel is lit.
+     */
+    bool getPixel(unsigned int x, unsigned int y) const
+    {
+        return ((getRow(x / 8U, y) >> (x % 8U)) & 0x1U) != 0U;
+    }
+
+    /**
+     * Computes the hash of the lit pixels, which identifies the frame shown
+     * without keeping it, eg. to compare it against a recorded one.
+     *
+     * @return The FNV-1a hash of the rows shown, top down, left to right.
+     */
+    uint64_t getFrameHash() const
+    {
+        auto hash = Util::kFnvOffset;
+
+        for (auto y = 0U; y < kDigitCnt; y++) {
+            for (auto segment = 0U; segment < getSegmentCnt(); segment++) {
+                auto row = getRow(segment, y);
+                hash     = Util::fnv1a(&row, sizeof(row), hash);
+            }
+        }
+
+        return hash;
+    }
+
+    /**
+     * Returns the traffic statistics.
+     *
+     * @return The statistics.
+     */
+    const Stats &getStats() const
+    {
+        return mStats;
+    }
+
+    /**
+     * Resets the traffic statistics, keeping the display content.
+     */
+    void resetStats()
+    {
+        mStats = Stats();
+    }
+
+    /**
+     * Dumps the lit pixels to the standard output.
+     */
+    void dump() const
+    {
+        for (auto y = 0U; y < kDigitCnt; y++) {
+            for (auto x = 0U; x < getSegmentCnt() * 8U; x++) {
+                std::cout << (getPixel(x, y) ? 'X' : '-');
+            }
+            std::cout << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+
+    private:
+    /** Register addresses, according to the data sheet. */
+    enum Register : uint8_t {
+        noOp        = 0x00U,
+        digit0      = 0x01U,
+        decodeMode  = 0x09U,
+        intensity   = 0x0AU,
+        scanLimit   = 0x0BU,
+        shutdown    = 0x0CU,
+        displayTest = 0x0FU,
+    };
+
+    /** Number of digit registers, ie. rows of a segment. */
+    static const unsigned int kDigitCnt = 8U;
+
+    /**
+     * Executes a command latched by a driver.
+     *
+     * @param[in] segment The zero based index of the driver.
+     * @param[in] address The register address.
+     * @param[in] value   The register value.
+     */
+    void execute(unsigned int segment, uint8_t address, uint8_t value)
+    {
+        /* Only the lower nibble of the address is decoded */
+        auto reg = static_cast<uint8_t>(address & 0x0FU);
+        if (reg == Register::noOp) {
+            mStats.noOps++;
+            return;
+        }
+
+        auto &current = mRegisters[segment][reg];
+        if (current == value) {
+            mStats.redundantWrites++;
+            return;
+        }
+
+        current = value;
+        mStats.writes++;
+    }
+
+    /** Register file of each driver, indexed by the register address. */
+    std::vector<std::array<uint8_t, 16U>> mRegisters;
+
+    /** Content of the shift registers of the chain, see write(). */
+    std::vector<uint8_t> mShift;
+
+    /** Scratch copy of mShift, kept to avoid allocations. */
+    std::vector<uint8_t> mNextShift;
+
+    /** Traffic statistics. */
+    Stats mStats;
+};
+
+} // namespace Spi
+
+} // namespace Device
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+
+#include "spi-base.hpp"
+
+namespace Device
+{
+
+namespace Spi
+{
+
+/**
+ * SPI device that discards all the data, only counting it. Useful for
+ * measuring the cost of the code driving the bus.
+ */
+class Null : public Device::Spi::SpiBase
+{
+    public:
+    /**
+     * Discards the buffer.
+     *
+     * @param[in] buffer The buffer to be sent.
+     * @param[in] length The number of bytes in the buffer.
+     */
+    virtual void write(const uint8_t *buffer, std::size_t length) override
+    {
+        (void)buffer;
+
+        mBytes += length;
+        mMessages++;
+    }
+
+    /**
+     * Discards the messages.
+     *
+     * @param[in] messages The messages to be sent.
+     * @param[in] count    The number of messages.
+     */
+    virtual void writeFrame(const Message *messages,
+                            std::size_t count) override
+    {
+        for (std::size_t i = 0U; i < count; i++) {
+            mBytes += messages[i].length;
+        }
+
+        mMessages += count;
+        mFrames++;
+    }
+
+    /**
+     * Returns the number of bytes written so far.
+     *
+     * @return The number of bytes.
+     */
+    unsigned long long getBytes() const
+    {
+        return mBytes;
+    }
+
+    /**
+     * Returns the number of messages written so far.
+     *
+     * @return The number of messages.
+     */
+    unsigned long long getMessages() const
+    {
+        return mMessages;
+    }
+
+    /**
+     * Returns the number of writeFrame() calls so far.
+     *
+     * @return The number of frames.
+     */
+    unsigned long long getFrames() const
+    {
+        return mFrames;
+    }
+
+    private:
+    /** Number of bytes written. */
+    unsigned long long mBytes = 0U;
+
+    /** Number of messages written. */
+    unsigned long long mMessages = 0U;
+
+    /** Number of frames written. */
+    unsigned long long mFrames = 0U;
+};
+
+} // namespace Spi
+
+} // namespace Device
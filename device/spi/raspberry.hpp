@@ -44,6 +44,8 @@ class Raspberry : public Device::Spi::SpiBase
         if (mFakeDevice == false) {
             setupDevice();
         }
+
+        mTransfers.reserve(kMaxTransfers);
     }
 
     /**
@@ -58,26 +60,112 @@ class Raspberry : public Device::Spi::SpiBase
      * Writes buffer to the device via SPI protocol.
      *
      * @param[in] buffer The buffer to be sent.
+     * @param[in] length The number of bytes in the buffer.
      */
-    virtual void write(const std::vector<uint8_t> &buffer) override
+    virtual void write(const uint8_t *buffer, std::size_t length) override
     {
         /*
          * The alternative to writing to the device is using ioctl()
-         * with the SPI_IOC_MESSAGE macro. This gives more control, but
-         * in this case it is not needed, and using write() allows
-         * regular files to be used instead of spi device file,
-         * simplifying SPI protocol debugging (in this case, fakeSpi
+         * with the SPI_IOC_MESSAGE macro, see writeFrame(). Using
+         * write() allows regular files to be used instead of spi device
+         * file, simplifying SPI protocol debugging (in this case, fakeSpi
          * must also be set to true).
          * For more info on the alternative approach, look for
          * "torvalds spi dev test".
          */
-        int ret = ::write(mDevice, buffer.data(), buffer.size());
+        auto ret = ::write(mDevice, buffer, length);
         if (ret < 1) {
             throw std::domain_error("can't send spi message");
         }
     }
 
+    /**
+     * Writes a sequence of buffers to the device, each as a separate SPI
+     * message. The messages are submitted as a single SPI_IOC_MESSAGE
+     * ioctl(), with the chip select toggled between them, so that the
+     * whole sequence costs a single system call. When writing to a regular
+     * file, the messages are written one by one.
+     *
+     * @param[in] messages The messages to be sent, in order.
+     * @param[in] count    The number of messages.
+     */
+    virtual void writeFrame(const Message *messages,
+                            std::size_t count) override
+    {
+        if (mFakeDevice) {
+            SpiBase::writeFrame(messages, count);
+            return;
+        }
+
+        std::size_t first = 0U;
+        while (first < count) {
+            first = submit(messages, count, first);
+        }
+    }
+
     private:
+    /**
+     * Maximum number of transfers in a single ioctl(), as the size of the
+     * transfer array must fit into the ioctl size field.
+     */
+    static const std::size_t kMaxTransfers = 256U;
+
+    /**
+     * Maximum number of bytes in a single ioctl(), matching the default
+     * spidev buffer size.
+     */
+    static const std::size_t kMaxBytes = 4096U;
+
+    /**
+     * Submits as many messages as fit into a single ioctl().
+     *
+     * @param[in] messages The messages to be sent.
+     * @param[in] count    The number of messages.
+     * @param[in] first    Index of the first message to send.
+     *
+     * @return Index of the first message that was not sent.
+     */
+    std::size_t
+    submit(const Message *messages, std::size_t count, std::size_t first)
+    {
+        auto &transfers   = mTransfers;
+        std::size_t bytes = 0U;
+        std::size_t last  = first;
+
+        transfers.clear();
+        while (last < count && transfers.size() < kMaxTransfers) {
+            const auto &message = messages[last];
+
+            if (!transfers.empty() && bytes + message.length > kMaxBytes) {
+                break;
+            }
+
+            spi_ioc_transfer transfer{};
+            transfer.tx_buf    = reinterpret_cast<uintptr_t>(message.data);
+            transfer.len       = static_cast<uint32_t>(message.length);
+            transfer.cs_change = 1U;
+            transfers.push_back(transfer);
+
+            bytes += message.length;
+            last++;
+        }
+
+        if (transfers.empty()) {
+            return last;
+        }
+
+        /* For the last transfer, cs_change would keep the chip selected */
+        transfers.back().cs_change = 0U;
+
+        auto cnt = static_cast<unsigned int>(transfers.size());
+        int ret  = ioctl(mDevice, SPI_IOC_MESSAGE(cnt), transfers.data());
+        if (ret < 1) {
+            throw std::domain_error("can't send spi message");
+        }
+
+        return last;
+    }
+
     /**
      * Sets the SPI device. The settings are currently fixed and only
      * intended to be working with MAX7219 led driver.
@@ -105,6 +193,9 @@ class Raspberry : public Device::Spi::SpiBase
         }
     }
 
+    /** Transfers of the ioctl() being submitted, kept to avoid allocation. */
+    std::vector<spi_ioc_transfer> mTransfers;
+
     /** The path of the SPI device, typically /dev/spi*.* */
     std::string mSpiDevPath;
 
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <cinttypes>
-#include <vector>
+#include <cstddef>
 
 namespace Device
 {
@@ -9,6 +9,17 @@ namespace Device
 namespace Spi
 {
 
+/**
+ * A non-owning view of a single SPI message.
+ */
+struct Message {
+    /** Pointer to the first byte of the message. */
+    const uint8_t *data;
+
+    /** Number of bytes in the message. */
+    std::size_t length;
+};
+
 /**
  * This class defines the SPI interface.
  */
@@ -24,8 +35,25 @@ class SpiBase
      * Writes buffer to the device via SPI protocol.
      *
      * @param[in] buffer The buffer to be sent.
+     * @param[in] length The number of bytes in the buffer.
+     */
+    virtual void write(const uint8_t *buffer, std::size_t length) = 0;
+
+    /**
+     * Writes a sequence of buffers to the device, each as a separate SPI
+     * message (ie. the chip select is toggled between them). Implementations
+     * may submit the whole sequence at once, the default implementation
+     * simply writes the messages one by one.
+     *
+     * @param[in] messages The messages to be sent, in order.
+     * @param[in] count    The number of messages.
      */
-    virtual void write(const std::vector<uint8_t> &buffer) = 0;
+    virtual void writeFrame(const Message *messages, std::size_t count)
+    {
+        for (std::size_t i = 0U; i < count; i++) {
+            write(messages[i].data, messages[i].length);
+        }
+    }
 };
 
 } // namespace Spi
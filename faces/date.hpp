@@ -2,7 +2,7 @@
 
 #include "face.hpp"
 #include "font/font5x7.hpp"
-#include "util/painter.hpp"
+#include "util/strip-cache.hpp"
 #include "util/time.hpp"
 
 namespace Faces
@@ -18,9 +18,12 @@ class Date : public Face
     using F = Font::Font5by7;
 
     Util::ScrollingDisplay *mDisplay;
+    Util::StripCache *mCache;
 
     public:
-    explicit Date(Util::ScrollingDisplay *display) : mDisplay(display)
+    explicit Date(Util::ScrollingDisplay *display,
+                  Util::StripCache *cache = nullptr)
+        : mDisplay(display), mCache(cache)
     {
     }
 
@@ -29,9 +32,8 @@ class Date : public Face
      */
     void prepare() override
     {
-        auto time = Util::getTime("%A %e%b");
-        mDisplay->clear();
-        Util::Painter::writeText<F>(mDisplay, 0U, 0U, time);
+        const auto &date = Util::TimeService::shared().get("%A %e%b");
+        Util::renderText<F>(mDisplay, mCache, date);
     }
 
     /**
@@ -2,22 +2,55 @@
 
 #include "face.hpp"
 #include "font/font5x7.hpp"
-#include "util/painter.hpp"
+#include "util/column-source.hpp"
+#include "util/file-watch.hpp"
+#include "util/hash.hpp"
+#include "util/read-file.hpp"
+#include "util/strip-cache.hpp"
 
-#include <fstream>
-#include <streambuf>
+#include <string>
+#include <vector>
 
 namespace Faces
 {
 
 /**
- * Shows the given string through a ScrollingDisplay.
+ * Shows the content of a text file through a ScrollingDisplay.
+ *
+ * The file is watched for changes and only loaded again once it has been
+ * written or replaced. The text is only rendered again if its content has
+ * actually changed, otherwise the previously rendered strip is reused. Long
+ * texts are streamed rather than rendered up front.
+ *
+ * The file may be replaced atomically or rewritten in place: it is read
+ * rather than mapped, so a writer truncating it meanwhile only leads to a
+ * short read, soon followed by a reload once the writer closes it.
  */
 class File : public Face
 {
     Util::ScrollingDisplay *mDisplay;
     std::string mPath;
     std::string mErrorStr;
+    Util::StripCache *mCache;
+    Util::FileWatch mWatch;
+
+    /** The content of the file read last, kept to avoid allocations. */
+    std::string mContent;
+
+    /** The hash of the text shown, valid if mLoaded is true. */
+    uint64_t mHash = 0U;
+
+    /** True if the text has been loaded. */
+    bool mLoaded = false;
+
+    /** The rendered text, shared with the display, unless streamed. */
+    Util::ScrollingDisplay::Strip mStrip;
+
+    /** The streamed text, if mStreamed is true. */
+    Util::TextColumns<Font::Font5by7> mColumns;
+
+    /** True if the text is too long to be rendered up front. */
+    bool mStreamed = false;
 
     public:
     /**
@@ -26,11 +59,14 @@ class File : public Face
      * @param[in] display  The pointer to the scrolling display.
      * @param[in] path     The path of the file to load.
      * @param[in] errorStr The string to show if file cannot be loaded.
+     * @param[in] cache    The cache of rendered strips, or nullptr.
      */
     File(Util::ScrollingDisplay *display,
          const std::string &path,
-         const std::string &errorStr = "---")
-        : mDisplay(display), mPath(path), mErrorStr(errorStr)
+         const std::string &errorStr = "---",
+         Util::StripCache *cache     = nullptr)
+        : mDisplay(display), mPath(path), mErrorStr(errorStr), mCache(cache),
+          mWatch(path)
     {
     }
 
@@ -39,24 +75,15 @@ class File : public Face
      */
     void prepare() override
     {
-        // Load the whole file into string
-        std::ifstream fileStream(mPath);
-        std::string text;
-
-        if (fileStream.good()) {
-            text = std::string{std::istreambuf_iterator<char>(fileStream),
-                               std::istreambuf_iterator<char>()};
+        if (mWatch.changed()) {
+            load();
+        }
 
-            // Remove last character, as stream includes EOF.
-            text.pop_back();
+        if (mStreamed) {
+            mDisplay->stream(&mColumns);
         } else {
-            text = mErrorStr;
+            mDisplay->adoptStrip(mStrip);
         }
-
-        // Render the string into the display
-        mDisplay->clear();
-        Util::Painter::writeText<Font::Font5by7>(
-            mDisplay, 0U, 0U, text.c_str());
     }
 
     /**
@@ -66,5 +93,51 @@ class File : public Face
     {
         return mDisplay->slideIn();
     }
+
+    /**
+     * Returns the watch of the file, eg. to handle its events as they come.
+     *
+     * @return The watch.
+     */
+    Util::FileWatch &getWatch()
+    {
+        return mWatch;
+    }
+
+    private:
+    /**
+     * Loads the file, rendering its content if it differs from the one
+     * already rendered.
+     */
+    void load()
+    {
+        const char *text = mErrorStr.data();
+        auto length      = mErrorStr.size();
+
+        if (Util::readFile(mPath, &mContent)) {
+            /* The last character, typically a newline, is not shown */
+            text   = mContent.data();
+            length = mContent.empty() ? 0U : mContent.size() - 1U;
+        }
+
+        auto hash = Util::fnv1a(text, length);
+        if (mLoaded && hash == mHash) {
+            return;
+        }
+
+        mHash     = hash;
+        mLoaded   = true;
+        mStreamed = length > Util::kStreamLength;
+
+        if (mStreamed) {
+            mColumns.setText(std::string(text, length));
+            mStrip.reset();
+            return;
+        }
+
+        Util::renderText<Font::Font5by7>(
+            mDisplay, mCache, std::string(text, length));
+        mStrip = mDisplay->getStrip();
+    }
 };
 } // namespace Faces
@@ -1,45 +1,250 @@
 #pragma once
 
 #include <chrono>
-#include <thread>
+#include <functional>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "face.hpp"
+#include "util/clock.hpp"
+#include "util/metrics.hpp"
 
 namespace Faces
 {
 
+/**
+ * Runs the clock faces in a loop, each preceded by the separator face.
+ *
+ * Animation frames are scheduled against absolute deadlines on a monotonic
+ * clock, so that the time spent rendering and refreshing the display does
+ * not add up to the nominal frame period of the face. The clock is
+ * injectable, so that with a Util::VirtualClock the faces run as fast as
+ * possible, eg. for a headless simulation.
+ */
 class Runner
 {
-    std::vector<std::unique_ptr<Faces::Face>> &mFaces;
-    Face &mSeparator;
-
     public:
-    Runner(std::vector<std::unique_ptr<Faces::Face>> &faces, Face &separator)
-        : mFaces(faces), mSeparator(separator)
+    /** The clock whose time points are used for frame scheduling. */
+    using Clock = std::chrono::steady_clock;
+
+    /** Called after every frame rendered. */
+    using FrameListener = std::function<void()>;
+
+    /** Selects what happens when a frame misses its deadline. */
+    enum class OverrunPolicy {
+        /**
+         * The missed frame slots are dropped and the next frame is scheduled
+         * at the next slot still ahead, keeping the phase of the schedule.
+         * The animation slows down.
+         */
+        skip,
+
+        /**
+         * The missed frames are run back to back, without sleeping, until
+         * the animation is back on schedule. The animation keeps its speed,
+         * unless it is late by more than kMaxCatchUp frames.
+         */
+        catchUp,
+    };
+
+    /** Frame scheduling statistics. */
+    struct Stats {
+        /** Number of animation frames run. */
+        unsigned long frames = 0U;
+
+        /** Number of frames that finished after their deadline. */
+        unsigned long missedDeadlines = 0U;
+
+        /** Overrun of the last frame that missed its deadline. */
+        Clock::duration lastOverrun = Clock::duration::zero();
+
+        /** The largest overrun of a frame. */
+        Clock::duration maxOverrun = Clock::duration::zero();
+
+        /** Sum of overruns of all frames. */
+        Clock::duration totalOverrun = Clock::duration::zero();
+    };
+
+    /**
+     * Maximal number of frame periods the animation can be late before the
+     * catch up policy gives up and drops the missed slots, as the skip
+     * policy does.
+     */
+    static const int kMaxCatchUp = 10;
+
+    Runner(std::vector<std::unique_ptr<Faces::Face>> &faces,
+           Face &separator,
+           OverrunPolicy policy = OverrunPolicy::catchUp,
+           Util::Clock &clock   = Util::SystemClock::instance())
+        : mFaces(faces), mSeparator(separator), mPolicy(policy), mClock(clock)
     {
     }
 
-    void run()
+    /**
+     * Runs the faces.
+     *
+     * @param[in] cycles The number of times all the faces are shown, zero
+     *                   to run until the clock is stopped.
+     */
+    void run(unsigned long cycles = 0U)
     {
-        for (;;) {
+        for (auto cycle = 0UL; cycles == 0U || cycle < cycles; cycle++) {
             for (auto &face : mFaces) {
+                if (mClock.isStopped()) {
+                    return;
+                }
 
                 animate(&mSeparator);
                 animate(face.get());
 
-                std::this_thread::sleep_for(face->transitionSleep());
+                mClock.sleepFor(face->transitionSleep());
+                DOTCLOCK_METRICS_POLL();
             }
         }
     }
 
     void animate(Face *face)
     {
+        prepareFace(face);
+
+        const Clock::duration period = face->animationSleep();
+        auto deadline                = mClock.now();
+
+        while (!mClock.isStopped()) {
+            bool more = runFrame(face);
+
+            /* The last frame is shown too, so it is counted as well */
+            mStats.frames++;
+            DOTCLOCK_METRICS_ADD(frames, 1U);
+            DOTCLOCK_METRICS_POLL();
+
+            if (!more) {
+                break;
+            }
+
+            deadline += period;
+
+            /* A late frame is run at once, or at a later slot, see policy */
+            auto now = mClock.now();
+            if (now > deadline) {
+                deadline = reschedule(deadline, now, period);
+            }
+
+            mClock.sleepUntil(deadline);
+        }
+    }
+
+    /**
+     * Returns the frame scheduling statistics.
+     *
+     * @return The statistics.
+     */
+    const Stats &getStats() const
+    {
+        return mStats;
+    }
+
+    /**
+     * Sets the function called after every frame rendered, including the
+     * last frame of each face animation.
+     *
+     * @param[in] listener The listener, or an empty function for none.
+     */
+    void setFrameListener(FrameListener listener)
+    {
+        mFrameListener = std::move(listener);
+    }
+
+    private:
+    /**
+     * Prepares the face for drawing.
+     *
+     * @param[in] face The face.
+     */
+    void prepareFace(Face *face)
+    {
+        DOTCLOCK_METRICS_TIME(prepare);
         face->prepare();
-        while (face->run()) {
-            std::this_thread::sleep_for(face->animationSleep());
+    }
+
+    /**
+     * Renders a single frame of the face.
+     *
+     * @param[in] face The face.
+     *
+     * @return The result of Face::run().
+     */
+    bool runFrame(Face *face)
+    {
+        bool more;
+        {
+            DOTCLOCK_METRICS_TIME(run);
+            more = face->run();
+        }
+
+        if (mFrameListener) {
+            mFrameListener();
+        }
+
+        return more;
+    }
+
+    /**
+     * Accounts for a missed deadline and computes the deadline the next
+     * frame is scheduled against, according to the overrun policy.
+     *
+     * @param[in] deadline The deadline that was missed.
+     * @param[in] now      The current time.
+     * @param[in] period   The frame period.
+     *
+     * @return The new deadline.
+     */
+    Clock::time_point reschedule(Clock::time_point deadline,
+                                 Clock::time_point now,
+                                 Clock::duration period)
+    {
+        auto overrun = now - deadline;
+
+        mStats.missedDeadlines++;
+        DOTCLOCK_METRICS_ADD(lateFrames, 1U);
+
+        mStats.lastOverrun = overrun;
+        mStats.totalOverrun += overrun;
+        if (overrun > mStats.maxOverrun) {
+            mStats.maxOverrun = overrun;
+        }
+
+        if (period <= Clock::duration::zero()) {
+            return now;
         }
+
+        auto maxLate = period * Clock::rep{kMaxCatchUp};
+        if (mPolicy == OverrunPolicy::catchUp && overrun < maxLate) {
+            return deadline;
+        }
+
+        /* Drop the missed slots, keeping the phase of the schedule */
+        auto missed = overrun / period + 1;
+        DOTCLOCK_METRICS_ADD(droppedFrames, missed);
+
+        return deadline + period * missed;
     }
+
+    std::vector<std::unique_ptr<Faces::Face>> &mFaces;
+    Face &mSeparator;
+
+    /** What happens when a frame misses its deadline. */
+    OverrunPolicy mPolicy;
+
+    /** The source of time, and of sleeping. */
+    Util::Clock &mClock;
+
+    /** Called after every frame rendered. */
+    FrameListener mFrameListener;
+
+    /** Frame scheduling statistics. */
+    Stats mStats;
 };
 
 } /* namespace Faces */
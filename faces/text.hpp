@@ -2,18 +2,22 @@
 
 #include "face.hpp"
 #include "font/font5x7.hpp"
-#include "util/painter.hpp"
+#include "util/column-source.hpp"
+#include "util/strip-cache.hpp"
 
 namespace Faces
 {
 
 /**
- * Shows the given string through a ScrollingDisplay.
+ * Shows the given string through a ScrollingDisplay. Long strings are
+ * streamed rather than rendered up front.
  */
 class Text : public Face
 {
     Util::ScrollingDisplay *mDisplay;
     std::string mText;
+    Util::StripCache *mCache;
+    Util::TextColumns<Font::Font5by7> mColumns;
 
     public:
     /**
@@ -21,9 +25,12 @@ class Text : public Face
      *
      * @param[in] display The pointer to the scrolling display.
      * @param[in] text    The string to show.
+     * @param[in] cache   The cache of rendered strips, or nullptr.
      */
-    Text(Util::ScrollingDisplay *display, const std::string &text)
-        : mDisplay(display), mText(text)
+    Text(Util::ScrollingDisplay *display,
+         const std::string &text,
+         Util::StripCache *cache = nullptr)
+        : mDisplay(display), mText(text), mCache(cache), mColumns(text)
     {
     }
 
@@ -32,9 +39,12 @@ class Text : public Face
      */
     void prepare() override
     {
-        mDisplay->clear();
-        Util::Painter::writeText<Font::Font5by7>(
-            mDisplay, 0U, 0U, mText.c_str());
+        if (mText.size() > Util::kStreamLength) {
+            mDisplay->stream(&mColumns);
+            return;
+        }
+
+        Util::renderText<Font::Font5by7>(mDisplay, mCache, mText);
     }
 
     /**
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "face.hpp"
+#include "font/atlas.hpp"
 #include "font/font5x7.hpp"
-#include "util/painter.hpp"
+#include "util/scrolling-display.hpp"
 #include "util/time.hpp"
 
 namespace Faces
@@ -10,14 +16,27 @@ namespace Faces
 
 /**
  * Shows the current time.
+ *
+ * The face keeps its previous render and only redraws the glyphs of the
+ * characters that have changed since. The display device compares each
+ * frame with what it is already showing, so only the segments covered by
+ * the redrawn glyphs are sent to it.
  */
 class Time : public Face
 {
-    using F = Font::Font5by7;
-    Util::ScrollingDisplay *mDisplay;
+    using F      = Font::Font5by7;
+    using Glyphs = Font::Atlas<F>;
 
     public:
-    explicit Time(Util::ScrollingDisplay *display) : mDisplay(display)
+    /** Selects how the time is presented. */
+    enum class Mode {
+        scrolling, /**< The time scrolls in, like any other face. */
+        live,      /**< The time is shown in place, without scrolling. */
+    };
+
+    explicit Time(Util::ScrollingDisplay *display,
+                  Mode mode = Mode::scrolling)
+        : mDisplay(display), mMode(mode)
     {
     }
 
@@ -26,18 +45,147 @@ class Time : public Face
      */
     void prepare() override
     {
-        auto time = Util::getTime("%H:%M");
-        mDisplay->clear();
-        Util::Painter::writeText<F>(mDisplay, 0U, 0U, time);
+        update();
+        mDisplay->adoptStrip(mStrip);
+        mPresented = false;
     }
 
     /**
+     * Slides the time in, or, in live mode, keeps showing it in place until
+     * the clock the face is run against is stopped. The live time is only
+     * presented again when it changes.
+     *
      * @see Face::run()
      */
     bool run() override
     {
+        if (mMode == Mode::live) {
+            if (update() || !mPresented) {
+                mDisplay->adoptStrip(mStrip);
+                mDisplay->present();
+                mPresented = true;
+            }
+
+            return true;
+        }
+
         return mDisplay->slideIn();
     }
+
+    private:
+    /**
+     * Renders the current time, if it has changed since it was rendered
+     * last.
+     *
+     * @return True if the time was rendered.
+     */
+    bool update()
+    {
+        auto &service = Util::TimeService::shared();
+        auto revision = service.getRevision(kFormat);
+
+        if (revision == mRevision) {
+            return false;
+        }
+
+        render(service.get(kFormat));
+        mRevision = revision;
+
+        return true;
+    }
+
+    /**
+     * Updates the rendered strip to show the given text. Only the glyphs
+     * that differ from the previous text are redrawn, unless the layout of
+     * the text has changed.
+     *
+     * @param[in] text The text to render.
+     */
+    void render(const std::string &text)
+    {
+        bool sameLayout = text.size() == mText.size();
+
+        for (auto i = 0U; sameLayout && i < text.size(); i++) {
+            sameLayout = Glyphs::width(symbol(text, i)) ==
+                         Glyphs::width(symbol(mText, i));
+        }
+
+        if (!sameLayout) {
+            layout(text);
+        }
+
+        for (auto i = 0U; i < text.size(); i++) {
+            if (!sameLayout || text[i] != mText[i]) {
+                auto ch = symbol(text, i);
+                std::copy(Glyphs::columns(ch),
+                          Glyphs::columns(ch) + Glyphs::width(ch),
+                          mStrip->begin() + mCellX[i]);
+            }
+        }
+
+        mText = text;
+    }
+
+    /**
+     * Computes the position of every glyph cell and resizes the strip to
+     * fit the text. The strip ends with the last column of the last glyph.
+     *
+     * @param[in] text The text to lay out.
+     */
+    void layout(const std::string &text)
+    {
+        unsigned int x   = 0U;
+        unsigned int end = 0U;
+
+        mCellX.clear();
+        for (auto i = 0U; i < text.size(); i++) {
+            mCellX.push_back(x);
+            end = x + Glyphs::width(symbol(text, i));
+            x += Glyphs::advance(symbol(text, i));
+        }
+
+        mStrip->assign(end, 0U);
+    }
+
+    /**
+     * Returns the symbol at the given position of the text.
+     *
+     * @param[in] text The text.
+     * @param[in] i    The position within the text.
+     *
+     * @return The symbol.
+     */
+    static uint8_t symbol(const std::string &text, unsigned int i)
+    {
+        return static_cast<uint8_t>(text[i]);
+    }
+
+    /** The format of the time. */
+    static constexpr const char *kFormat = "%H:%M";
+
+    Util::ScrollingDisplay *mDisplay;
+
+    /** The presentation mode. */
+    Mode mMode;
+
+    /** The revision of the time that was rendered last. */
+    unsigned long mRevision = 0U;
+
+    /** True once the live time has been presented since prepare(). */
+    bool mPresented = false;
+
+    /** The text that was rendered last. */
+    std::string mText;
+
+    /** The X coordinate of each glyph cell. */
+    std::vector<unsigned int> mCellX;
+
+    /**
+     * The rendered text, one byte per column. It is shared with the display,
+     * which adopts it again whenever it changes.
+     */
+    std::shared_ptr<std::vector<uint8_t>> mStrip =
+        std::make_shared<std::vector<uint8_t>>();
 };
 
 } // namespace Faces
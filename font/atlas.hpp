@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cinttypes>
+
+namespace Font
+{
+
+/**
+ * Provides glyphs of any font as display-ready column bytes, with bit N of a
+ * column holding the pixel of the Nth row. The table is built at compile time
+ * from the font's `at()' accessor, regardless of the layout of the font data,
+ * so the lookups have no runtime conversion or startup cost.
+ *
+ * Symbols not covered by the font are rendered as blank glyphs.
+ *
+ * @tparam Font The font class, providing `width', `height', `glyphCnt' and
+ *              a constexpr `at(x, y, symbol)' method.
+ */
+template <typename Font> class Atlas
+{
+    static_assert(Font::height <= 8U, "Glyphs must fit into a column byte");
+
+    public:
+    /** Number of symbols covered by the atlas. */
+    static const unsigned int kSymbolCnt = 256U;
+
+    /**
+     * Returns the columns of the glyph.
+     *
+     * @param[in] symbol The symbol.
+     *
+     * @return Pointer to `width(symbol)' column bytes.
+     */
+    static constexpr const uint8_t *columns(unsigned char symbol)
+    {
+        return kTable.columns[symbol];
+    }
+
+    /**
+     * Returns the width of the glyph. The fonts are fixed-width, so every
+     * glyph is as wide as the font.
+     *
+     * @param[in] symbol The symbol.
+     *
+     * @return The width of the glyph, in pixels, excluding the spacing.
+     */
+    static constexpr unsigned int width(unsigned char symbol)
+    {
+        (void)symbol;
+        return Font::width;
+    }
+
+    /**
+     * Returns the horizontal distance between this and the next glyph.
+     *
+     * @param[in] symbol The symbol.
+     *
+     * @return The advance, in pixels.
+     */
+    static constexpr unsigned int advance(unsigned char symbol)
+    {
+        return width(symbol) + Font::spacing;
+    }
+
+    private:
+    /** The glyph table. */
+    struct Table {
+        uint8_t columns[kSymbolCnt][Font::width];
+    };
+
+    /**
+     * Converts the font into the glyph table.
+     *
+     * @return The glyph table.
+     */
+    static constexpr Table build()
+    {
+        Table table{};
+
+        for (auto ch = 0U; ch < Font::glyphCnt && ch < kSymbolCnt; ch++) {
+            for (auto x = 0U; x < Font::width; x++) {
+                uint8_t column = 0U;
+                for (auto y = 0U; y < Font::height; y++) {
+                    if (Font::at(x, y, static_cast<unsigned char>(ch))) {
+                        column = static_cast<uint8_t>(column | (1U << y));
+                    }
+                }
+
+                table.columns[ch][x] = column;
+            }
+        }
+
+        return table;
+    }
+
+    static constexpr Table kTable = build();
+};
+
+template <typename Font>
+constexpr typename Atlas<Font>::Table Atlas<Font>::kTable;
+
+} // namespace Font
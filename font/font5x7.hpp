@@ -1,9 +1,11 @@
 #pragma once
 
+#include <cinttypes>
+
 namespace Font
 {
 
-static const unsigned char data5by7[] = {
+static constexpr uint8_t data5by7[] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x3E, 0x5B, 0x4F, 0x5B, 0x3E, 0x3E, 0x6B,
     0x4F, 0x6B, 0x3E, 0x1C, 0x3E, 0x7C, 0x3E, 0x1C, 0x18, 0x3C, 0x7E, 0x3C,
     0x18, 0x1C, 0x57, 0x7D, 0x57, 0x1C, 0x1C, 0x5E, 0x7F, 0x5E, 0x1C, 0x00,
@@ -115,11 +117,12 @@ static const unsigned char data5by7[] = {
 class Font5by7
 {
     public:
-    static const unsigned int width   = 5U;
-    static const unsigned int height  = 8U;
-    static const unsigned int spacing = 1U;
+    static const unsigned int width    = 5U;
+    static const unsigned int height   = 8U;
+    static const unsigned int spacing  = 1U;
+    static const unsigned int glyphCnt = sizeof(data5by7) / width;
 
-    static bool at(unsigned int x, unsigned int y, unsigned char ch)
+    static constexpr bool at(unsigned int x, unsigned int y, unsigned char ch)
     {
         return (data5by7[ch * width + x] & (1U << y)) != 0U;
     }
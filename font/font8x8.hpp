@@ -5,7 +5,7 @@
 namespace Font
 {
 
-static const uint8_t data8by8[128][8] = {
+static constexpr uint8_t data8by8[128][8] = {
     {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // U+0000 (nul)
     {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // U+0001
     {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // U+0002
@@ -139,11 +139,12 @@ static const uint8_t data8by8[128][8] = {
 class Font8by8
 {
     public:
-    static const unsigned int width   = 8U;
-    static const unsigned int height  = 8U;
-    static const unsigned int spacing = 0U;
+    static const unsigned int width    = 8U;
+    static const unsigned int height   = 8U;
+    static const unsigned int spacing  = 0U;
+    static const unsigned int glyphCnt = 128U;
 
-    static bool at(unsigned int x, unsigned int y, unsigned char ch)
+    static constexpr bool at(unsigned int x, unsigned int y, unsigned char ch)
     {
         return (data8by8[ch][y] & (1U << x)) != 0U;
     }
@@ -1,10 +1,27 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "device/display/composite.hpp"
 #include "device/display/max7219.hpp"
+#include "device/display/threaded.hpp"
+#include "device/spi/max7219-emulator.hpp"
 #include "device/spi/raspberry.hpp"
+#include "util/clock.hpp"
+#include "util/event-loop.hpp"
+#include "util/metrics.hpp"
 #include "util/scrolling-display.hpp"
+#include "util/strip-cache.hpp"
+#include "util/time.hpp"
 
 #include "faces/date.hpp"
 #include "faces/file.hpp"
@@ -12,29 +29,189 @@
 #include "faces/text.hpp"
 #include "faces/time.hpp"
 
+/** Calendar time the simulation starts at, unless given. */
+static const std::time_t kSimulationEpoch = 1700000000;
+
+/**
+ * Runs the clock faces on the display.
+ *
+ * @param[in] output   The display.
+ * @param[in] clock    The clock the faces are scheduled against.
+ * @param[in] events   The event loop handling the file watches between the
+ *                     frames, or nullptr.
+ * @param[in] cycles   The number of times all the faces are shown, zero to
+ *                     run until the clock is stopped.
+ * @param[in] listener Called after every frame rendered.
+ * @param[in] live     True to only show the time, in place, updated as it
+ *                     changes.
+ */
+static void runFaces(Device::Display::DisplayBase *output,
+                     Util::Clock &clock,
+                     Util::EventLoop *events,
+                     unsigned long cycles,
+                     Faces::Runner::FrameListener listener,
+                     bool live = false)
+{
+    Util::ScrollingDisplay scrollingDisplay(output);
+    Util::StripCache stripCache;
+
+    Faces::Text separator(&scrollingDisplay, " ", &stripCache);
+
+    std::vector<std::unique_ptr<Faces::Face>> faces;
+    Util::FileWatch *watch = nullptr;
+
+    if (live) {
+        /* The live time is shown until stopped, no other face would run */
+        faces.emplace_back(std::make_unique<Faces::Time>(
+            &scrollingDisplay, Faces::Time::Mode::live));
+    } else {
+        faces.emplace_back(std::make_unique<Faces::Time>(&scrollingDisplay));
+        faces.emplace_back(
+            std::make_unique<Faces::Date>(&scrollingDisplay, &stripCache));
+        auto weather = std::make_unique<Faces::File>(
+            &scrollingDisplay, "tmp/weather", "---", &stripCache);
+
+        /* The file changes are read as they come, the face reloads it */
+        if (events != nullptr && weather->getWatch().getFd() >= 0) {
+            watch = &weather->getWatch();
+            events->add(watch->getFd(), EPOLLIN, [watch](uint32_t) {
+                watch->update();
+            });
+        }
+        faces.emplace_back(std::move(weather));
+    }
+
+    Faces::Runner runner(
+        faces, separator, Faces::Runner::OverrunPolicy::catchUp, clock);
+    runner.setFrameListener(std::move(listener));
+    runner.run(cycles);
+
+    if (watch != nullptr) {
+        events->remove(watch->getFd());
+    }
+}
+
+/**
+ * Runs the faces headless, against a virtual clock, as fast as possible.
+ * The hash of every frame shown by an emulated display is printed to the
+ * standard output, and the achieved frame rate to the standard error
+ * output.
+ *
+ * @param[in] cycles The number of times all the faces are shown.
+ * @param[in] epoch  The calendar time the simulation starts at.
+ */
+static void simulate(unsigned long cycles, std::time_t epoch)
+{
+    /* Make the frames independent of the local time zone */
+    ::setenv("TZ", "UTC", 1);
+    ::tzset();
+
+    Device::Spi::Max7219Emulator spi(4U);
+    Device::Display::Max7219 display(spi, 32U, false);
+
+    Util::VirtualClock clock(epoch);
+    Util::TimeService::shared().setSource(
+        [&clock]() { return clock.wallTime(); });
+
+    auto frames   = 0UL;
+    auto listener = [&]() {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            clock.getElapsed());
+
+        std::cout << frames++ << ',' << ms.count() << ',' << std::hex
+                  << std::setw(16) << std::setfill('0') << spi.getFrameHash()
+                  << std::dec << '\n';
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    runFaces(&display, clock, nullptr, cycles, listener);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout.flush();
+    std::cerr << "frames: " << frames << ", simulated: "
+              << std::chrono::duration<double>(clock.getElapsed()).count()
+              << " s, elapsed: " << elapsed.count() << " s, fps: "
+              << static_cast<double>(frames) / elapsed.count() << std::endl;
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc != 2) {
-        std::cout << "Usage: " << argv[0] << " <spi-device|test>" << std::endl;
+    if (argc >= 3 && std::strcmp(argv[1], "simulate") == 0) {
+        auto cycles = std::strtoul(argv[2], nullptr, 10);
+        auto epoch  = argc >= 4 ? static_cast<std::time_t>(
+                                     std::strtoll(argv[3], nullptr, 10))
+                                : kSimulationEpoch;
+        simulate(cycles == 0U ? 1U : cycles, epoch);
+        return 0;
+    }
+
+    if (argc < 2 || argc > 4) {
+        std::cout << "Usage: " << argv[0]
+                  << " <spi-device[,spi-device...]|test> [threaded] [live]"
+                  << std::endl
+                  << "       " << argv[0] << " simulate <cycles> [epoch]"
+                  << std::endl;
         return 0;
     }
 
     bool inTestMode = std::strcmp(argv[1], "test") == 0;
+    bool threaded   = false;
+    bool live       = false;
+    for (auto i = 2; i < argc; i++) {
+        threaded = threaded || std::strcmp(argv[i], "threaded") == 0;
+        live     = live || std::strcmp(argv[i], "live") == 0;
+    }
+
+    /* Set up before any thread is started, so that none receives them */
+    Util::EventLoop events;
+    events.addSignal(SIGTERM, [&events](int) { events.stop(); });
+    events.addSignal(SIGINT, [&events](int) { events.stop(); });
 
-    Device::Spi::Raspberry spi(argv[1], inTestMode);
-    Device::Display::Max7219 display(spi, 32U, inTestMode);
-    Util::ScrollingDisplay scrollingDisplay(&display);
+    /* Several comma separated devices form a single, wider display */
+    std::vector<std::string> devices;
+    std::istringstream list(argv[1]);
+    for (std::string device; std::getline(list, device, ',');) {
+        devices.push_back(device);
+    }
+    if (devices.empty()) {
+        devices.emplace_back(argv[1]);
+    }
 
-    Faces::Text separator(&scrollingDisplay, " ");
+    std::vector<std::unique_ptr<Device::Spi::Raspberry>> spis;
+    std::vector<std::unique_ptr<Device::Display::Max7219>> chains;
+    std::vector<Device::Display::Composite::Chain> parts;
+    for (const auto &device : devices) {
+        spis.emplace_back(
+            std::make_unique<Device::Spi::Raspberry>(device, inTestMode));
+        chains.emplace_back(std::make_unique<Device::Display::Max7219>(
+            *spis.back(), 32U, inTestMode));
+        parts.push_back({chains.back().get(), 32U});
+    }
 
-    std::vector<std::unique_ptr<Faces::Face>> faces;
-    faces.emplace_back(std::make_unique<Faces::Time>(&scrollingDisplay));
-    faces.emplace_back(std::make_unique<Faces::Date>(&scrollingDisplay));
-    faces.emplace_back(
-        std::make_unique<Faces::File>(&scrollingDisplay, "tmp/weather"));
+    Device::Display::DisplayBase *output = chains.front().get();
+    std::unique_ptr<Device::Display::Composite> composite;
+    if (chains.size() > 1U) {
+        composite = std::make_unique<Device::Display::Composite>(parts);
+        output    = composite.get();
+    }
+
+    /* Optionally, the display is refreshed from a separate thread */
+    std::unique_ptr<Device::Display::Threaded> pipeline;
+    if (threaded) {
+        pipeline = std::make_unique<Device::Display::Threaded>(
+            output, 32U * static_cast<unsigned int>(chains.size()));
+        output = pipeline.get();
+    }
+
+    DOTCLOCK_METRICS_EXPORT("tmp/metrics.prom", std::chrono::seconds(10));
+
+    runFaces(output, events, &events, 0U, nullptr, live);
 
-    Faces::Runner runner(faces, separator);
-    runner.run();
+    /* Stopped by a signal, leave the display dark, even if throttled */
+    output->clear();
+    output->refresh();
+    output->flush();
 
     return 0;
 }
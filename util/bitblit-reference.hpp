@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+
+#include "util/screenbuffer.hpp"
+
+namespace Util
+{
+
+/**
+ * Straightforward, pixel by pixel implementations of the ScreenBuffer
+ * bit-blit operations. These are slow and only meant to verify the results
+ * of the word-parallel implementations.
+ */
+namespace BitBlitReference
+{
+
+/**
+ * Combines two pixels.
+ *
+ * @param[in] dst The destination pixel.
+ * @param[in] src The source pixel.
+ * @param[in] op  The combining operation.
+ *
+ * @return The resulting pixel.
+ */
+inline bool combine(bool dst, bool src, BitBlit::Op op)
+{
+    switch (op) {
+    case BitBlit::Op::bitOr:
+        return dst || src;
+    case BitBlit::Op::bitXor:
+        return dst != src;
+    case BitBlit::Op::bitAnd:
+        return dst && src;
+    case BitBlit::Op::copy:
+    default:
+        return src;
+    }
+}
+
+/**
+ * @see ScreenBuffer::shiftColumnsLeft()
+ */
+inline void shiftColumnsLeft(ScreenBuffer *buffer, unsigned int cnt)
+{
+    auto width = buffer->getSegmentCnt() * 8U;
+
+    for (auto y = 0U; y < buffer->getHeight(); y++) {
+        for (auto x = 0U; x < width; x++) {
+            bool pixel = x + cnt < width && buffer->getBit(x + cnt, y);
+            buffer->putBit(x, y, pixel);
+        }
+    }
+}
+
+/**
+ * @see ScreenBuffer::blit()
+ */
+inline void blit(ScreenBuffer *dst,
+                 const ScreenBuffer &src,
+                 unsigned int srcX,
+                 unsigned int srcY,
+                 unsigned int width,
+                 unsigned int height,
+                 unsigned int dstX,
+                 unsigned int dstY,
+                 BitBlit::Op op = BitBlit::Op::copy)
+{
+    auto srcWidth = src.getSegmentCnt() * 8U;
+    auto dstWidth = dst->getSegmentCnt() * 8U;
+
+    /* Read the whole region first, as the buffers may be the same one */
+    std::vector<bool> pixels(width * height);
+    for (auto y = 0U; y < height; y++) {
+        for (auto x = 0U; x < width; x++) {
+            pixels[y * width + x] = src.getBit(srcX + x, srcY + y);
+        }
+    }
+
+    for (auto y = 0U; y < height; y++) {
+        for (auto x = 0U; x < width; x++) {
+            bool outside = srcX + x >= srcWidth || dstX + x >= dstWidth ||
+                           srcY + y >= src.getHeight();
+            if (outside) {
+                continue;
+            }
+
+            bool pixel = dst->getBit(dstX + x, dstY + y);
+            dst->putBit(dstX + x,
+                        dstY + y,
+                        combine(pixel, pixels[y * width + x], op));
+        }
+    }
+}
+
+/**
+ * @see ScreenBuffer::fill()
+ */
+inline void fill(ScreenBuffer *buffer,
+                 unsigned int x,
+                 unsigned int y,
+                 unsigned int width,
+                 unsigned int height,
+                 bool pixel)
+{
+    for (auto j = 0U; j < height; j++) {
+        for (auto i = 0U; i < width; i++) {
+            buffer->putBit(x + i, y + j, pixel);
+        }
+    }
+}
+
+/**
+ * @see ScreenBuffer::invert()
+ */
+inline void invert(ScreenBuffer *buffer,
+                   unsigned int x,
+                   unsigned int y,
+                   unsigned int width,
+                   unsigned int height)
+{
+    for (auto j = 0U; j < height; j++) {
+        for (auto i = 0U; i < width; i++) {
+            buffer->putBit(x + i, y + j, !buffer->getBit(x + i, y + j));
+        }
+    }
+}
+
+} // namespace BitBlitReference
+
+} // namespace Util
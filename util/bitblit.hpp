@@ -0,0 +1,353 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON))
+#define DOTCLOCK_BLIT_SIMD 1
+#endif
+
+namespace Util
+{
+
+/**
+ * Word-parallel kernels operating on rows of pixels packed into 64-bit words,
+ * with the leftmost pixel of a word held by its least significant bit. The
+ * kernels are the building blocks of the ScreenBuffer bit-blit operations.
+ */
+namespace BitBlit
+{
+
+/** Type of a single storage word. */
+using Word = uint64_t;
+
+/** Number of pixels stored in a single word. */
+constexpr unsigned int kWordBits = 64U;
+
+/**
+ * Selects how the source pixels are combined with the destination pixels.
+ */
+enum class Op {
+    copy,   /**< The destination is replaced by the source. */
+    bitOr,  /**< The source is OR-ed into the destination. */
+    bitXor, /**< The source is XOR-ed into the destination. */
+    bitAnd, /**< The source is AND-ed into the destination. */
+};
+
+/**
+ * Combines a single destination word with the source word, affecting only
+ * the bits selected by the mask.
+ *
+ * @param[in] dst  The destination word.
+ * @param[in] src  The source word.
+ * @param[in] mask The bits to be modified.
+ * @param[in] op   The combining operation.
+ *
+ * @return The new value of the destination word.
+ */
+inline Word combine(Word dst, Word src, Word mask, Op op)
+{
+    switch (op) {
+    case Op::bitOr:
+        return dst | (src & mask);
+    case Op::bitXor:
+        return dst ^ (src & mask);
+    case Op::bitAnd:
+        return dst & (src | ~mask);
+    case Op::copy:
+    default:
+        return (dst & ~mask) | (src & mask);
+    }
+}
+
+/**
+ * Combines whole, equally aligned words. Uses 128-bit vectors when the
+ * target supports them. The ranges must not overlap.
+ *
+ * @param[out] dst The destination words.
+ * @param[in]  src The source words.
+ * @param[in]  cnt The number of words.
+ * @param[in]  op  The combining operation.
+ */
+inline void combineWords(Word *dst, const Word *src, std::size_t cnt, Op op)
+{
+    std::size_t i = 0U;
+
+#ifdef DOTCLOCK_BLIT_SIMD
+    typedef Word Vector __attribute__((vector_size(16)));
+    constexpr std::size_t kLanes = sizeof(Vector) / sizeof(Word);
+
+    for (; i + kLanes <= cnt; i += kLanes) {
+        Vector d;
+        Vector s;
+        std::memcpy(&d, dst + i, sizeof(d));
+        std::memcpy(&s, src + i, sizeof(s));
+
+        switch (op) {
+        case Op::bitOr:
+            d |= s;
+            break;
+        case Op::bitXor:
+            d ^= s;
+            break;
+        case Op::bitAnd:
+            d &= s;
+            break;
+        case Op::copy:
+        default:
+            d = s;
+            break;
+        }
+
+        std::memcpy(dst + i, &d, sizeof(d));
+    }
+#endif
+
+    for (; i < cnt; i++) {
+        dst[i] = combine(dst[i], src[i], ~Word{0U}, op);
+    }
+}
+
+/**
+ * Returns the mask selecting bits of the given word that fall into the
+ * pixel span [x, x + width).
+ *
+ * @param[in] word  The index of the word within the row.
+ * @param[in] x     The first pixel of the span.
+ * @param[in] width The number of pixels in the span, must be positive.
+ *
+ * @return The mask.
+ */
+inline Word spanMask(std::size_t word, std::size_t x, std::size_t width)
+{
+    std::size_t first = word * kWordBits;
+    std::size_t begin = x > first ? x - first : 0U;
+    std::size_t end   = x + width - first;
+
+    Word mask = ~Word{0U} << begin;
+    if (end < kWordBits) {
+        mask &= ~(~Word{0U} << end);
+    }
+
+    return mask;
+}
+
+/**
+ * Loads 64 consecutive pixels of a row, starting at the given (possibly
+ * negative) pixel. Pixels outside of the row are read as zeros.
+ *
+ * @param[in] row   The row words.
+ * @param[in] words The number of words in the row.
+ * @param[in] x     The first pixel to load.
+ *
+ * @return The pixels, with the pixel x held by the least significant bit.
+ */
+inline Word load(const Word *row, std::size_t words, int64_t x)
+{
+    if (x < 0) {
+        if (x <= -static_cast<int64_t>(kWordBits)) {
+            return 0U;
+        }
+
+        return load(row, words, 0) << static_cast<unsigned int>(-x);
+    }
+
+    auto ind   = static_cast<std::size_t>(x) / kWordBits;
+    auto shift = static_cast<unsigned int>(x % kWordBits);
+    Word lo    = ind < words ? row[ind] : 0U;
+    Word hi    = ind + 1U < words ? row[ind + 1U] : 0U;
+
+    return shift == 0U ? lo : (lo >> shift) | (hi << (kWordBits - shift));
+}
+
+/**
+ * Combines a span of pixels of the source row into the destination row.
+ * The rows may be the same row, in which case the spans may overlap.
+ *
+ * @param[out] dst      The destination row words.
+ * @param[in]  dstX     The first destination pixel.
+ * @param[in]  src      The source row words.
+ * @param[in]  srcWords The number of words in the source row.
+ * @param[in]  srcX     The first source pixel.
+ * @param[in]  width    The number of pixels in the span.
+ * @param[in]  op       The combining operation.
+ */
+inline void blitRow(Word *dst,
+                    std::size_t dstX,
+                    const Word *src,
+                    std::size_t srcWords,
+                    std::size_t srcX,
+                    std::size_t width,
+                    Op op)
+{
+    if (width == 0U) {
+        return;
+    }
+
+    std::size_t first = dstX / kWordBits;
+    std::size_t last  = (dstX + width - 1U) / kWordBits;
+    auto offset = static_cast<int64_t>(srcX) - static_cast<int64_t>(dstX);
+
+    auto blitWord = [&](std::size_t i) {
+        auto x = static_cast<int64_t>(i * kWordBits) + offset;
+        dst[i] = combine(
+            dst[i], load(src, srcWords, x), spanMask(i, dstX, width), op);
+    };
+
+    bool overlaps = dst == src;
+    bool aligned  = offset % static_cast<int64_t>(kWordBits) == 0;
+
+    /* Whole, equally aligned inner words are combined in bulk */
+    if (!overlaps && aligned && last > first + 1U) {
+        auto delta = offset / static_cast<int64_t>(kWordBits);
+        auto begin = first + 1U;
+        auto end   = last;
+
+        if (static_cast<int64_t>(end) + delta <=
+                static_cast<int64_t>(srcWords) &&
+            static_cast<int64_t>(begin) + delta >= 0) {
+            blitWord(first);
+            combineWords(dst + begin,
+                         src + static_cast<int64_t>(begin) + delta,
+                         end - begin,
+                         op);
+            blitWord(last);
+            return;
+        }
+    }
+
+    /* Moving right within the same row must go from right to left */
+    if (overlaps && offset < 0) {
+        for (auto i = last + 1U; i-- > first;) {
+            blitWord(i);
+        }
+    } else {
+        for (auto i = first; i <= last; i++) {
+            blitWord(i);
+        }
+    }
+}
+
+/**
+ * Sets or clears a span of pixels of the row.
+ *
+ * @param[out] row   The row words.
+ * @param[in]  x     The first pixel of the span.
+ * @param[in]  width The number of pixels in the span.
+ * @param[in]  pixel True to set the pixels, false to clear them.
+ */
+inline void fillRow(Word *row, std::size_t x, std::size_t width, bool pixel)
+{
+    if (width == 0U) {
+        return;
+    }
+
+    Word value = pixel ? ~Word{0U} : 0U;
+    for (auto i = x / kWordBits; i <= (x + width - 1U) / kWordBits; i++) {
+        row[i] = combine(row[i], value, spanMask(i, x, width), Op::copy);
+    }
+}
+
+/**
+ * Inverts a span of pixels of the row.
+ *
+ * @param[out] row   The row words.
+ * @param[in]  x     The first pixel of the span.
+ * @param[in]  width The number of pixels in the span.
+ */
+inline void invertRow(Word *row, std::size_t x, std::size_t width)
+{
+    if (width == 0U) {
+        return;
+    }
+
+    for (auto i = x / kWordBits; i <= (x + width - 1U) / kWordBits; i++) {
+        row[i] ^= spanMask(i, x, width);
+    }
+}
+
+/**
+ * Transposes an 8x8 matrix of pixels, packed into a word one byte per line.
+ * Bit j of byte i is moved to bit i of byte j, so that eight column bytes
+ * become eight row bytes and vice versa.
+ *
+ * @param[in] x The matrix to transpose.
+ *
+ * @return The transposed matrix.
+ */
+inline Word transpose8x8(Word x)
+{
+    Word t = (x ^ (x >> 7U)) & 0x00AA00AA00AA00AAULL;
+    x      = x ^ t ^ (t << 7U);
+    t      = (x ^ (x >> 14U)) & 0x0000CCCC0000CCCCULL;
+    x      = x ^ t ^ (t << 14U);
+    t      = (x ^ (x >> 28U)) & 0x00000000F0F0F0F0ULL;
+    x      = x ^ t ^ (t << 28U);
+
+    return x;
+}
+
+/**
+ * Mirrors an 8x8 matrix of pixels, packed into a word one byte per line, by
+ * reversing the order of the bits within each byte.
+ *
+ * @param[in] x The matrix to mirror.
+ *
+ * @return The mirrored matrix.
+ */
+inline Word mirror8x8(Word x)
+{
+    const Word bits    = 0x5555555555555555ULL;
+    const Word pairs   = 0x3333333333333333ULL;
+    const Word nibbles = 0x0F0F0F0F0F0F0F0FULL;
+
+    x = ((x >> 1U) & bits) | ((x & bits) << 1U);
+    x = ((x >> 2U) & pairs) | ((x & pairs) << 2U);
+    x = ((x >> 4U) & nibbles) | ((x & nibbles) << 4U);
+
+    return x;
+}
+
+/**
+ * Flips an 8x8 matrix of pixels, packed into a word one byte per line, by
+ * reversing the order of the bytes.
+ *
+ * @param[in] x The matrix to flip.
+ *
+ * @return The flipped matrix.
+ */
+inline Word flip8x8(Word x)
+{
+    return __builtin_bswap64(x);
+}
+
+/**
+ * Shifts the pixels of the row to the left by the given number of pixels.
+ * The pixels shifted in from the right are cleared.
+ *
+ * @param[out] row   The row words.
+ * @param[in]  words The number of words in the row.
+ * @param[in]  cnt   The number of pixels to shift by.
+ */
+inline void shiftRowLeft(Word *row, std::size_t words, std::size_t cnt)
+{
+    std::size_t skip  = cnt / kWordBits;
+    auto shift        = static_cast<unsigned int>(cnt % kWordBits);
+    std::size_t moved = skip < words ? words - skip : 0U;
+
+    if (shift == 0U) {
+        std::memmove(row, row + skip, moved * sizeof(Word));
+    } else {
+        for (std::size_t i = 0U; i < moved; i++) {
+            Word hi = i + skip + 1U < words ? row[i + skip + 1U] : 0U;
+            row[i]  = (row[i + skip] >> shift) | (hi << (kWordBits - shift));
+        }
+    }
+
+    std::memset(row + moved, 0, (words - moved) * sizeof(Word));
+}
+
+} // namespace BitBlit
+
+} // namespace Util
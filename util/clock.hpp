@@ -0,0 +1,178 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+#include <thread>
+
+namespace Util
+{
+
+/**
+ * Source of time used for scheduling, abstracted so that the application
+ * can run against a virtual clock instead of the real one.
+ */
+class Clock
+{
+    public:
+    /** A point on the monotonic timeline. */
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    /** A duration on the monotonic timeline. */
+    using Duration = std::chrono::steady_clock::duration;
+
+    /**
+     * Virtual destructor is a must for polymorphic base class.
+     */
+    virtual ~Clock() = default;
+
+    /**
+     * Returns the current monotonic time.
+     *
+     * @return The current time.
+     */
+    virtual TimePoint now() = 0;
+
+    /**
+     * Waits until the given monotonic time.
+     *
+     * @param[in] deadline The time to wait for.
+     */
+    virtual void sleepUntil(TimePoint deadline) = 0;
+
+    /**
+     * Returns the current calendar time.
+     *
+     * @return The current time, as std::time() returns it.
+     */
+    virtual std::time_t wallTime() = 0;
+
+    /**
+     * Checks if the clock has been stopped. Sleeping on a stopped clock
+     * returns at once, so anything scheduled against it should finish.
+     *
+     * @return True if the clock has been stopped.
+     */
+    virtual bool isStopped() const
+    {
+        return false;
+    }
+
+    /**
+     * Waits for the given time.
+     *
+     * @param[in] duration The time to wait.
+     */
+    void sleepFor(Duration duration)
+    {
+        sleepUntil(now() + duration);
+    }
+};
+
+/**
+ * The real clock of the system.
+ */
+class SystemClock : public Clock
+{
+    public:
+    /**
+     * Returns the system clock.
+     *
+     * @return The clock.
+     */
+    static SystemClock &instance()
+    {
+        static SystemClock clock;
+        return clock;
+    }
+
+    /**
+     * @see Clock::now()
+     */
+    TimePoint now() override
+    {
+        return std::chrono::steady_clock::now();
+    }
+
+    /**
+     * @see Clock::sleepUntil()
+     */
+    void sleepUntil(TimePoint deadline) override
+    {
+        std::this_thread::sleep_until(deadline);
+    }
+
+    /**
+     * @see Clock::wallTime()
+     */
+    std::time_t wallTime() override
+    {
+        return std::time(nullptr);
+    }
+};
+
+/**
+ * Clock that only advances when slept on, so that sleeping returns at once.
+ * Anything scheduled against it runs as fast as possible, and, as no time
+ * passes while working, deterministically.
+ */
+class VirtualClock : public Clock
+{
+    public:
+    /**
+     * Constructs the clock.
+     *
+     * @param[in] epoch The calendar time the clock starts at.
+     */
+    explicit VirtualClock(std::time_t epoch) : mEpoch(epoch)
+    {
+    }
+
+    /**
+     * @see Clock::now()
+     */
+    TimePoint now() override
+    {
+        return TimePoint(mElapsed);
+    }
+
+    /**
+     * Advances the clock to the deadline, if it is in the future.
+     *
+     * @param[in] deadline The time to advance to.
+     */
+    void sleepUntil(TimePoint deadline) override
+    {
+        if (deadline.time_since_epoch() > mElapsed) {
+            mElapsed = deadline.time_since_epoch();
+        }
+    }
+
+    /**
+     * @see Clock::wallTime()
+     */
+    std::time_t wallTime() override
+    {
+        using std::chrono::seconds;
+        auto elapsed = std::chrono::duration_cast<seconds>(mElapsed);
+        return mEpoch + static_cast<std::time_t>(elapsed.count());
+    }
+
+    /**
+     * Returns the time elapsed since the clock was constructed.
+     *
+     * @return The elapsed time.
+     */
+    Duration getElapsed() const
+    {
+        return mElapsed;
+    }
+
+    private:
+    /** The calendar time the clock started at. */
+    std::time_t mEpoch;
+
+    /** The time elapsed since the start. */
+    Duration mElapsed = Duration::zero();
+};
+
+} // namespace Util
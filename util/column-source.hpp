@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+
+#include "font/atlas.hpp"
+
+namespace Util
+{
+
+/**
+ * Texts longer than this are streamed to the ScrollingDisplay rather than
+ * rendered up front, see ScrollingDisplay::stream().
+ */
+constexpr std::size_t kStreamLength = 256U;
+
+/**
+ * Produces columns of pixels on demand, one byte per column with bit N
+ * holding the pixel of the Nth row.
+ */
+class ColumnSource
+{
+    public:
+    /**
+     * Virtual destructor is a must for polymorphic base class.
+     */
+    virtual ~ColumnSource() = default;
+
+    /**
+     * Produces the next columns.
+     *
+     * @param[out] columns The storage for the columns.
+     * @param[in]  cnt     The maximal number of columns to produce.
+     *
+     * @return The number of columns produced, zero once all the columns
+     *         have been produced.
+     */
+    virtual unsigned int read(uint8_t *columns, unsigned int cnt) = 0;
+
+    /**
+     * Restarts the production from the first column.
+     */
+    virtual void rewind() = 0;
+};
+
+/**
+ * Rasterizes a text lazily, producing the same columns Painter::writeText()
+ * would draw, one glyph at a time.
+ *
+ * @tparam Font The font class.
+ */
+template <typename Font> class TextColumns : public ColumnSource
+{
+    public:
+    /**
+     * Constructs the source.
+     *
+     * @param[in] text The text to rasterize.
+     */
+    explicit TextColumns(const std::string &text = std::string())
+        : mText(text)
+    {
+    }
+
+    /**
+     * Replaces the text, restarting the production.
+     *
+     * @param[in] text The text to rasterize.
+     */
+    void setText(const std::string &text)
+    {
+        mText = text;
+        rewind();
+    }
+
+    /**
+     * @see ColumnSource::read()
+     */
+    unsigned int read(uint8_t *columns, unsigned int cnt) override
+    {
+        using Glyphs = ::Font::Atlas<Font>;
+        auto produced = 0U;
+
+        while (produced < cnt && mIndex < mText.size()) {
+            auto symbol = static_cast<unsigned char>(mText[mIndex]);
+            auto width  = Glyphs::width(symbol);
+
+            /* No spacing follows the last glyph */
+            auto cell = mIndex + 1U < mText.size() ? Glyphs::advance(symbol)
+                                                   : width;
+
+            columns[produced++] =
+                mColumn < width ? Glyphs::columns(symbol)[mColumn] : 0U;
+
+            if (++mColumn == cell) {
+                mColumn = 0U;
+                mIndex++;
+            }
+        }
+
+        return produced;
+    }
+
+    /**
+     * @see ColumnSource::rewind()
+     */
+    void rewind() override
+    {
+        mIndex  = 0U;
+        mColumn = 0U;
+    }
+
+    private:
+    /** The text. */
+    std::string mText;
+
+    /** Index of the symbol being rasterized. */
+    std::size_t mIndex = 0U;
+
+    /** Index of the next column within the glyph cell. */
+    unsigned int mColumn = 0U;
+};
+
+} // namespace Util
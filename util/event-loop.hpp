@@ -0,0 +1,325 @@
+#pragma once
+
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <utility>
+
+#include "util/clock.hpp"
+
+namespace Util
+{
+
+/**
+ * Single threaded event loop built on epoll, dispatching the readiness of
+ * file descriptors and the delivery of signals to handlers.
+ *
+ * The loop is also the clock the application is scheduled against: sleeping
+ * arms a timerfd with the absolute deadline and dispatches events until it
+ * expires, so that file watches, control sockets or signals are handled
+ * between the frames, without busy waiting and without delaying them.
+ * Signals are received through a signalfd, and so are only handled while
+ * the loop waits.
+ *
+ * Once stopped, for example by a SIGTERM handler, sleeping returns at once
+ * and isStopped() tells the users to finish.
+ */
+class EventLoop : public Clock
+{
+    public:
+    /** Handles the readiness of a file descriptor, given the epoll events. */
+    using Handler = std::function<void(uint32_t)>;
+
+    /** Handles a signal, given its number. */
+    using SignalHandler = std::function<void(int)>;
+
+    /**
+     * Constructs the loop.
+     */
+    EventLoop()
+    {
+        mEpollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (mEpollFd < 0) {
+            throw std::domain_error("can't create epoll instance");
+        }
+
+        /* steady_clock is CLOCK_MONOTONIC, so deadlines can be used as is */
+        mTimerFd =
+            ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (mTimerFd < 0) {
+            ::close(mEpollFd);
+            throw std::domain_error("can't create timer");
+        }
+
+        sigemptyset(&mSignals);
+        watch(mTimerFd, EPOLLIN);
+    }
+
+    /**
+     * Closes the loop. The signals stay blocked.
+     */
+    virtual ~EventLoop() override
+    {
+        if (mSignalFd >= 0) {
+            ::close(mSignalFd);
+        }
+
+        ::close(mTimerFd);
+        ::close(mEpollFd);
+    }
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    /**
+     * Starts dispatching the readiness of a file descriptor. The handler
+     * must consume the readiness (eg. read the data), as the events are
+     * level triggered.
+     *
+     * @param[in] fd      The file descriptor.
+     * @param[in] events  The epoll events to wait for, eg. EPOLLIN.
+     * @param[in] handler The handler.
+     */
+    void add(int fd, uint32_t events, Handler handler)
+    {
+        watch(fd, events);
+        mHandlers[fd] = std::move(handler);
+    }
+
+    /**
+     * Stops dispatching the readiness of a file descriptor. May be called
+     * from a handler.
+     *
+     * @param[in] fd The file descriptor.
+     */
+    void remove(int fd)
+    {
+        if (mHandlers.erase(fd) != 0U) {
+            ::epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+        }
+    }
+
+    /**
+     * Starts handling a signal. The signal is blocked, so that it is only
+     * received by the loop; threads inherit the mask of their creator, so
+     * this should be done before starting any thread.
+     *
+     * @param[in] signo   The signal number.
+     * @param[in] handler The handler.
+     */
+    void addSignal(int signo, SignalHandler handler)
+    {
+        sigaddset(&mSignals, signo);
+        if (::pthread_sigmask(SIG_BLOCK, &mSignals, nullptr) != 0) {
+            throw std::domain_error("can't block signal");
+        }
+
+        auto fd =
+            ::signalfd(mSignalFd, &mSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (fd < 0) {
+            throw std::domain_error("can't create signalfd");
+        }
+
+        if (mSignalFd < 0) {
+            mSignalFd = fd;
+            watch(mSignalFd, EPOLLIN);
+        }
+
+        mSignalHandlers[signo] = std::move(handler);
+    }
+
+    /**
+     * Dispatches events until the loop is stopped.
+     */
+    void run()
+    {
+        while (!mStopped) {
+            dispatch(-1);
+        }
+    }
+
+    /**
+     * Stops the loop. May be called from a handler.
+     */
+    void stop()
+    {
+        mStopped = true;
+    }
+
+    /**
+     * @see Clock::isStopped()
+     */
+    bool isStopped() const override
+    {
+        return mStopped;
+    }
+
+    /**
+     * @see Clock::now()
+     */
+    TimePoint now() override
+    {
+        return std::chrono::steady_clock::now();
+    }
+
+    /**
+     * Dispatches events until the deadline, or until the loop is stopped.
+     * The events already pending are dispatched even if the deadline has
+     * passed.
+     *
+     * @param[in] deadline The time to return at.
+     */
+    void sleepUntil(TimePoint deadline) override
+    {
+        if (mStopped) {
+            return;
+        }
+
+        if (deadline <= now()) {
+            dispatch(0);
+            return;
+        }
+
+        using std::chrono::duration_cast;
+
+        auto time = deadline.time_since_epoch();
+        auto secs = duration_cast<std::chrono::seconds>(time);
+        auto nsec = duration_cast<std::chrono::nanoseconds>(time - secs);
+
+        itimerspec spec       = {};
+        spec.it_value.tv_sec  = static_cast<time_t>(secs.count());
+        spec.it_value.tv_nsec = static_cast<long>(nsec.count());
+
+        auto ret =
+            ::timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+        if (ret != 0) {
+            throw std::domain_error("can't set timer");
+        }
+
+        mExpired = false;
+        while (!mExpired && !mStopped) {
+            dispatch(-1);
+        }
+    }
+
+    /**
+     * @see Clock::wallTime()
+     */
+    std::time_t wallTime() override
+    {
+        return std::time(nullptr);
+    }
+
+    private:
+    /** The largest number of events dispatched after a single wait. */
+    static const int kMaxEvents = 16;
+
+    /**
+     * Adds the file descriptor to the epoll set.
+     *
+     * @param[in] fd     The file descriptor.
+     * @param[in] events The epoll events to wait for.
+     */
+    void watch(int fd, uint32_t events)
+    {
+        epoll_event event = {};
+        event.events      = events;
+        event.data.fd     = fd;
+
+        if (::epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) != 0 &&
+            (errno != EEXIST ||
+             ::epoll_ctl(mEpollFd, EPOLL_CTL_MOD, fd, &event) != 0)) {
+            throw std::domain_error("can't watch file descriptor");
+        }
+    }
+
+    /**
+     * Waits for events and dispatches them.
+     *
+     * @param[in] timeout The longest time to wait, in milliseconds, or -1
+     *                    to wait indefinitely.
+     */
+    void dispatch(int timeout)
+    {
+        epoll_event events[kMaxEvents];
+
+        auto cnt = ::epoll_wait(mEpollFd, events, kMaxEvents, timeout);
+        if (cnt < 0) {
+            if (errno == EINTR) {
+                return;
+            }
+            throw std::domain_error("can't wait for events");
+        }
+
+        for (auto i = 0; i < cnt; i++) {
+            auto fd = events[i].data.fd;
+
+            if (fd == mTimerFd) {
+                uint64_t expirations;
+                if (::read(mTimerFd, &expirations, sizeof(expirations)) > 0) {
+                    mExpired = true;
+                }
+            } else if (fd == mSignalFd) {
+                dispatchSignals();
+            } else {
+                /* The handler is copied, as it may remove itself */
+                auto it = mHandlers.find(fd);
+                if (it != mHandlers.end()) {
+                    auto handler = it->second;
+                    handler(events[i].events);
+                }
+            }
+        }
+    }
+
+    /**
+     * Reads the pending signals and dispatches them.
+     */
+    void dispatchSignals()
+    {
+        signalfd_siginfo info;
+
+        while (::read(mSignalFd, &info, sizeof(info)) ==
+               static_cast<ssize_t>(sizeof(info))) {
+            auto signo = static_cast<int>(info.ssi_signo);
+            auto it    = mSignalHandlers.find(signo);
+            if (it != mSignalHandlers.end()) {
+                auto handler = it->second;
+                handler(signo);
+            }
+        }
+    }
+
+    /** The epoll file descriptor. */
+    int mEpollFd = -1;
+
+    /** The timer file descriptor, armed while sleeping. */
+    int mTimerFd = -1;
+
+    /** The signal file descriptor, -1 until a signal is handled. */
+    int mSignalFd = -1;
+
+    /** The signals handled. */
+    sigset_t mSignals;
+
+    /** The handlers of the file descriptors. */
+    std::map<int, Handler> mHandlers;
+
+    /** The handlers of the signals. */
+    std::map<int, SignalHandler> mSignalHandlers;
+
+    /** True once the timer has expired. */
+    bool mExpired = false;
+
+    /** True once the loop has been stopped. */
+    bool mStopped = false;
+};
+
+} // namespace Util
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace Util
+{
+
+/**
+ * Detects changes of a file using inotify.
+ *
+ * The parent directory is watched rather than the file itself, so that the
+ * file may not exist yet, and so that replacing it by renaming another file
+ * over it (the usual way of updating a file atomically) is detected as well.
+ * A change is reported when the file is closed after writing, renamed to the
+ * watched path, or removed.
+ *
+ * If inotify can not be used, or the directory does not exist yet, every
+ * call to changed() reports a change, so that users fall back to polling.
+ */
+class FileWatch
+{
+    public:
+    /**
+     * Starts watching the file.
+     *
+     * @param[in] path The path of the file.
+     */
+    explicit FileWatch(const std::string &path)
+    {
+        auto slash = path.rfind('/');
+        if (slash == std::string::npos) {
+            mDirectory = ".";
+            mName      = path;
+        } else {
+            mDirectory = slash == 0U ? "/" : path.substr(0U, slash);
+            mName      = path.substr(slash + 1U);
+        }
+
+        mFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        addWatch();
+    }
+
+    /**
+     * Stops watching the file.
+     */
+    ~FileWatch()
+    {
+        if (mFd >= 0) {
+            ::close(mFd);
+        }
+    }
+
+    FileWatch(const FileWatch &) = delete;
+    FileWatch &operator=(const FileWatch &) = delete;
+
+    /**
+     * Checks if the file has changed since the last call. The first call
+     * always reports a change. Does not block.
+     *
+     * @return True if the file may have changed.
+     */
+    bool changed()
+    {
+        if (mWatch < 0 && !addWatch()) {
+            return true;
+        }
+
+        update();
+
+        bool changed = mPending;
+        mPending     = false;
+
+        return changed;
+    }
+
+    /**
+     * Reads the pending events, so that the next call to changed() reports
+     * them. Meant to be called when getFd() becomes readable. Does not
+     * block.
+     */
+    void update()
+    {
+        if (mFd < 0) {
+            return;
+        }
+
+        alignas(inotify_event) char buffer[4096];
+
+        for (;;) {
+            auto length = ::read(mFd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                if (length < 0 && errno != EAGAIN && errno != EINTR) {
+                    mPending = true;
+                }
+                break;
+            }
+
+            if (parse(buffer, static_cast<std::size_t>(length))) {
+                mPending = true;
+            }
+        }
+    }
+
+    /**
+     * Returns the inotify file descriptor, readable whenever there are
+     * pending events, or -1 if inotify is not available.
+     *
+     * @return The file descriptor.
+     */
+    int getFd() const
+    {
+        return mFd;
+    }
+
+    private:
+    /**
+     * Adds the watch of the directory. The file is considered changed if
+     * the watch is (re)established, as the events before it were missed.
+     *
+     * @return True if the directory is being watched.
+     */
+    bool addWatch()
+    {
+        if (mFd < 0) {
+            return false;
+        }
+
+        mWatch = ::inotify_add_watch(mFd,
+                                     mDirectory.c_str(),
+                                     IN_CLOSE_WRITE | IN_MOVED_TO |
+                                         IN_MOVED_FROM | IN_DELETE |
+                                         IN_DELETE_SELF | IN_MOVE_SELF);
+        mPending = true;
+
+        return mWatch >= 0;
+    }
+
+    /**
+     * Parses the events read from the inotify file descriptor.
+     *
+     * @param[in] buffer The events.
+     * @param[in] length The number of bytes read.
+     *
+     * @return True if an event concerns the watched file.
+     */
+    bool parse(const char *buffer, std::size_t length)
+    {
+        bool changed = false;
+
+        for (std::size_t pos = 0U; pos + sizeof(inotify_event) <= length;) {
+            inotify_event event;
+            std::memcpy(&event, buffer + pos, sizeof(event));
+
+            const char *name = buffer + pos + sizeof(event);
+            pos += sizeof(event) + event.len;
+
+            /* The directory itself is gone, it has to be watched again */
+            if ((event.mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) !=
+                0U) {
+                mWatch  = -1;
+                changed = true;
+                continue;
+            }
+
+            if ((event.mask & IN_Q_OVERFLOW) != 0U ||
+                (event.len != 0U && mName == name)) {
+                changed = true;
+            }
+        }
+
+        return changed;
+    }
+
+    /** The directory holding the file. */
+    std::string mDirectory;
+
+    /** The name of the file within the directory. */
+    std::string mName;
+
+    /** The inotify file descriptor, -1 if inotify is not available. */
+    int mFd = -1;
+
+    /** The watch descriptor of the directory, -1 if not watched. */
+    int mWatch = -1;
+
+    /** True if a change was detected, and not reported by changed() yet. */
+    bool mPending = true;
+};
+
+} // namespace Util
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+
+namespace Util
+{
+
+/** The FNV-1a offset basis, the hash of no data. */
+constexpr uint64_t kFnvOffset = 14695981039346656037ULL;
+
+/**
+ * Computes the 64-bit FNV-1a hash of the data. Not suitable for anything
+ * security related, but cheap and good enough to detect changed content.
+ *
+ * @param[in] data   The data.
+ * @param[in] length The number of bytes.
+ * @param[in] seed   The hash to continue from, allowing the data to be
+ *                   hashed in pieces.
+ *
+ * @return The hash.
+ */
+inline uint64_t
+fnv1a(const void *data, std::size_t length, uint64_t seed = kFnvOffset)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    uint64_t hash     = seed;
+
+    for (std::size_t i = 0U; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+} // namespace Util
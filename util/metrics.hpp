@@ -0,0 +1,388 @@
+#pragma once
+
+/*
+ * Low overhead instrumentation of the rendering and refresh paths.
+ *
+ * The instrumentation is only compiled in when DOTCLOCK_METRICS is defined.
+ * Otherwise, all the DOTCLOCK_METRICS_* macros expand to nothing, including
+ * their arguments.
+ */
+
+#ifdef DOTCLOCK_METRICS
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace Util
+{
+
+namespace Metrics
+{
+
+/** Stages of a cycle whose latency is measured. */
+enum class Stage { prepare, run, refresh, spiWrite, count };
+
+/** Monotonically increasing counters. */
+enum class Counter {
+    frames,
+    lateFrames,
+    droppedFrames,
+    spiBytes,
+    spiTransactions,
+    stripCacheHits,
+    stripCacheMisses,
+    pipelineStalls,
+    count,
+};
+
+/** Per-frame quantities whose distribution is measured. */
+enum class Distribution {
+    spiBytesPerFrame,
+    spiTransactionsPerFrame,
+    pipelineDepth,
+    count,
+};
+
+/**
+ * Histogram with power of two buckets, safe to update from multiple threads.
+ */
+class Histogram
+{
+    public:
+    /** Number of buckets, excluding the +Inf one. */
+    static const unsigned int kBucketCnt = 24U;
+
+    /**
+     * Records a single value.
+     *
+     * @param[in] value The value.
+     */
+    void observe(uint64_t value)
+    {
+        auto bucket = 0U;
+        while (bucket < kBucketCnt && value > (uint64_t{1U} << bucket)) {
+            bucket++;
+        }
+
+        mBuckets[bucket].fetch_add(1U, std::memory_order_relaxed);
+        mSum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * Writes the histogram in the Prometheus text exposition format.
+     *
+     * @param[out] out    The stream to write to.
+     * @param[in]  name   The metric name.
+     * @param[in]  labels The labels, without braces, may be empty.
+     * @param[in]  scale  The factor to convert the values to the unit of
+     *                    the metric.
+     */
+    void write(std::ostream &out,
+               const std::string &name,
+               const std::string &labels,
+               double scale) const
+    {
+        auto sep        = labels.empty() ? "" : ",";
+        uint64_t counts = 0U;
+
+        for (auto i = 0U; i <= kBucketCnt; i++) {
+            counts += mBuckets[i].load(std::memory_order_relaxed);
+
+            out << name << "_bucket{" << labels << sep << "le=\"";
+            if (i < kBucketCnt) {
+                out << static_cast<double>(uint64_t{1U} << i) * scale;
+            } else {
+                out << "+Inf";
+            }
+            out << "\"} " << counts << "\n";
+        }
+
+        auto braces = labels.empty() ? "" : "{" + labels + "}";
+        out << name << "_sum" << braces << " "
+            << static_cast<double>(mSum.load(std::memory_order_relaxed)) *
+                   scale
+            << "\n";
+        out << name << "_count" << braces << " " << counts << "\n";
+    }
+
+    private:
+    /** Number of values in each bucket, the last one being +Inf. */
+    std::atomic<uint64_t> mBuckets[kBucketCnt + 1U] = {};
+
+    /** Sum of all values. */
+    std::atomic<uint64_t> mSum{0U};
+};
+
+/**
+ * Holds all the metrics of the application and exports them.
+ */
+class Registry
+{
+    public:
+    /**
+     * Returns the registry of the application.
+     *
+     * @return The registry.
+     */
+    static Registry &instance()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    /**
+     * Records the duration of a stage.
+     *
+     * @param[in] stage    The stage.
+     * @param[in] duration The duration.
+     */
+    void observe(Stage stage, std::chrono::nanoseconds duration)
+    {
+        auto us =
+            std::chrono::duration_cast<std::chrono::microseconds>(duration);
+        mStages[index(stage)].observe(static_cast<uint64_t>(us.count()));
+    }
+
+    /**
+     * Records a per-frame quantity.
+     *
+     * @param[in] distribution The quantity.
+     * @param[in] value        The value.
+     */
+    void observe(Distribution distribution, uint64_t value)
+    {
+        mDistributions[index(distribution)].observe(value);
+    }
+
+    /**
+     * Increments a counter.
+     *
+     * @param[in] counter The counter.
+     * @param[in] value   The increment.
+     */
+    void add(Counter counter, uint64_t value)
+    {
+        mCounters[index(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * Starts exporting the metrics to a file, and dumping them to the
+     * standard error output when SIGUSR1 is received.
+     *
+     * @param[in] path     The path of the file, rewritten atomically.
+     * @param[in] interval The time between two exports.
+     */
+    void setExport(const std::string &path, std::chrono::seconds interval)
+    {
+        mPath     = path;
+        mInterval = interval;
+        mNext     = std::chrono::steady_clock::now();
+
+        std::signal(SIGUSR1, onDumpSignal);
+    }
+
+    /**
+     * Exports the metrics if the export is due or was requested by a signal.
+     * Intended to be called regularly from the main loop.
+     */
+    void poll()
+    {
+        if (dumpRequested() != 0) {
+            dumpRequested() = 0;
+            write(std::cerr);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (mPath.empty() || now < mNext) {
+            return;
+        }
+
+        mNext = now + mInterval;
+        writeFile();
+    }
+
+    /**
+     * Writes all the metrics in the Prometheus text exposition format.
+     *
+     * @param[out] out The stream to write to.
+     */
+    void write(std::ostream &out) const
+    {
+        static const char *kStages[] = {"prepare", "run", "refresh", "spi"};
+        static const char *kCounters[] = {
+            "frames_total",
+            "late_frames_total",
+            "dropped_frames_total",
+            "spi_bytes_total",
+            "spi_transactions_total",
+            "strip_cache_hits_total",
+            "strip_cache_misses_total",
+            "pipeline_stalls_total",
+        };
+        static const char *kDistributions[] = {
+            "spi_bytes_per_frame",
+            "spi_transactions_per_frame",
+            "pipeline_queue_depth",
+        };
+
+        out << "# TYPE dotclock_stage_duration_seconds histogram\n";
+        for (auto i = 0U; i < index(Stage::count); i++) {
+            mStages[i].write(out,
+                             "dotclock_stage_duration_seconds",
+                             std::string("stage=\"") + kStages[i] + "\"",
+                             1e-6);
+        }
+
+        for (auto i = 0U; i < index(Distribution::count); i++) {
+            auto name = std::string("dotclock_") + kDistributions[i];
+            out << "# TYPE " << name << " histogram\n";
+            mDistributions[i].write(out, name, "", 1.0);
+        }
+
+        for (auto i = 0U; i < index(Counter::count); i++) {
+            auto name = std::string("dotclock_") + kCounters[i];
+            out << "# TYPE " << name << " counter\n";
+            out << name << " " << mCounters[i].load(std::memory_order_relaxed)
+                << "\n";
+        }
+    }
+
+    private:
+    Registry() = default;
+
+    /**
+     * Writes the metrics to a temporary file and renames it over the
+     * export path, so that readers never see a partially written file.
+     */
+    void writeFile() const
+    {
+        auto tmpPath = mPath + ".tmp";
+
+        {
+            std::ofstream file(tmpPath);
+            if (!file.good()) {
+                return;
+            }
+            write(file);
+        }
+
+        std::rename(tmpPath.c_str(), mPath.c_str());
+    }
+
+    /**
+     * Returns the flag set by the SIGUSR1 handler.
+     *
+     * @return Reference to the flag.
+     */
+    static volatile std::sig_atomic_t &dumpRequested()
+    {
+        static volatile std::sig_atomic_t requested = 0;
+        return requested;
+    }
+
+    /**
+     * Handles SIGUSR1 by requesting a dump on the next poll().
+     */
+    static void onDumpSignal(int)
+    {
+        dumpRequested() = 1;
+    }
+
+    /**
+     * Converts an enumerator to an array index.
+     */
+    template <typename T> static unsigned int index(T value)
+    {
+        return static_cast<unsigned int>(value);
+    }
+
+    /** Latency of each stage, in microseconds. */
+    Histogram mStages[static_cast<unsigned int>(Stage::count)];
+
+    /** Per-frame quantities. */
+    Histogram mDistributions[static_cast<unsigned int>(Distribution::count)];
+
+    /** Counters. */
+    std::atomic<uint64_t> mCounters[static_cast<unsigned int>(
+        Counter::count)] = {};
+
+    /** The path of the exported file, empty if not exported. */
+    std::string mPath;
+
+    /** The time between two exports. */
+    std::chrono::seconds mInterval{10};
+
+    /** The time of the next export. */
+    std::chrono::steady_clock::time_point mNext;
+};
+
+/**
+ * Measures the duration of its own lifetime as the duration of a stage.
+ */
+class ScopedTimer
+{
+    public:
+    explicit ScopedTimer(Stage stage)
+        : mStage(stage), mStart(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedTimer()
+    {
+        Registry::instance().observe(
+            mStage, std::chrono::steady_clock::now() - mStart);
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    private:
+    Stage mStage;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+} // namespace Metrics
+
+} // namespace Util
+
+#define DOTCLOCK_METRICS_CONCAT_(a, b) a##b
+#define DOTCLOCK_METRICS_CONCAT(a, b) DOTCLOCK_METRICS_CONCAT_(a, b)
+
+/** Measures the duration of the enclosing scope as the given stage. */
+#define DOTCLOCK_METRICS_TIME(stage)                                         \
+    Util::Metrics::ScopedTimer DOTCLOCK_METRICS_CONCAT(metricsTimer,         \
+                                                       __LINE__)(            \
+        Util::Metrics::Stage::stage)
+
+/** Increments the given counter. */
+#define DOTCLOCK_METRICS_ADD(counter, value)                                 \
+    Util::Metrics::Registry::instance().add(                                 \
+        Util::Metrics::Counter::counter, static_cast<uint64_t>(value))
+
+/** Records a per-frame quantity. */
+#define DOTCLOCK_METRICS_OBSERVE(distribution, value)                        \
+    Util::Metrics::Registry::instance().observe(                             \
+        Util::Metrics::Distribution::distribution,                           \
+        static_cast<uint64_t>(value))
+
+/** Exports the metrics, if due. */
+#define DOTCLOCK_METRICS_POLL() Util::Metrics::Registry::instance().poll()
+
+/** Starts exporting the metrics to the given file. */
+#define DOTCLOCK_METRICS_EXPORT(path, interval)                              \
+    Util::Metrics::Registry::instance().setExport(path, interval)
+
+#else
+
+#define DOTCLOCK_METRICS_TIME(stage)
+#define DOTCLOCK_METRICS_ADD(counter, value)
+#define DOTCLOCK_METRICS_OBSERVE(distribution, value)
+#define DOTCLOCK_METRICS_POLL()
+#define DOTCLOCK_METRICS_EXPORT(path, interval)
+
+#endif
@@ -3,6 +3,8 @@
 #include <cinttypes>
 #include <string>
 
+#include "font/atlas.hpp"
+
 namespace Util
 {
 
@@ -27,14 +29,47 @@ unsigned int writeChar(Display *display,
                        unsigned int startY,
                        uint8_t symbol)
 {
-    for (auto y = 0U; y < Font::height; y++) {
-        for (auto x = 0U; x < Font::width; x++) {
-            bool set = Font::at(x, y, symbol);
-            display->putPixel(x + startX, y + startY, set);
+    using Glyphs = ::Font::Atlas<Font>;
+
+    if (startY == 0U) {
+        display->blitColumns(
+            startX, Glyphs::columns(symbol), Glyphs::width(symbol));
+    } else {
+        for (auto y = 0U; y < Font::height; y++) {
+            for (auto x = 0U; x < Font::width; x++) {
+                bool set = Font::at(x, y, symbol);
+                display->putPixel(x + startX, y + startY, set);
+            }
         }
     }
 
-    return startX + Font::width + Font::spacing;
+    return startX + Glyphs::advance(symbol);
+}
+
+/**
+ * Measures the width of the string, as drawn by writeText().
+ *
+ * @tparam Font Font class to provide access to font pixmaps.
+ * @param[in] text The text to measure.
+ *
+ * @return The number of columns covered by the text, excluding the spacing
+ *         after the last character. The X coordinate returned by
+ *         writeText() also includes this spacing.
+ */
+template <typename Font> unsigned int measureText(const std::string &text)
+{
+    using Glyphs = ::Font::Atlas<Font>;
+
+    if (text.empty()) {
+        return 0U;
+    }
+
+    auto width = 0U;
+    for (auto ch : text) {
+        width += Glyphs::advance(static_cast<uint8_t>(ch));
+    }
+
+    return width - Font::spacing;
 }
 
 /**
@@ -53,7 +88,7 @@ template <typename Font, typename Display>
 unsigned int writeText(Display *display,
                        unsigned int startX,
                        unsigned int startY,
-                       std::string text)
+                       const std::string &text)
 {
     for (auto ch : text) {
         startX =
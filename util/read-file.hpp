@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cerrno>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Util
+{
+
+/**
+ * Reads a whole regular file into the string, reusing its storage.
+ *
+ * The file is read with read() rather than mapped: a file truncated by a
+ * writer while it is being read then just comes out short, where reading a
+ * mapping past the new end of the file raises SIGBUS.
+ *
+ * @param[in]  path    The path of the file.
+ * @param[out] content Receives the content of the file, cleared on failure.
+ *
+ * @return False if the file could not be opened or read.
+ */
+inline bool readFile(const std::string &path, std::string *content)
+{
+    content->clear();
+
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    /* The size is only a hint, the file may change while being read */
+    content->resize(static_cast<std::size_t>(info.st_size) + 1U);
+
+    std::size_t length = 0U;
+    for (;;) {
+        if (length == content->size()) {
+            content->resize(content->size() * 2U);
+        }
+
+        auto ret =
+            ::read(fd, &(*content)[length], content->size() - length);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret < 0) {
+            content->clear();
+            ::close(fd);
+            return false;
+        }
+        if (ret == 0) {
+            break;
+        }
+
+        length += static_cast<std::size_t>(ret);
+    }
+
+    content->resize(length);
+    ::close(fd);
+
+    return true;
+}
+
+} // namespace Util
@@ -1,40 +1,70 @@
 #pragma once
 
+#include <algorithm>
 #include <cinttypes>
 #include <iostream>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
+#include "util/bitblit.hpp"
+
 namespace Util
 {
 
 /**
  * Abstracts low level bit operations on the display buffer and exposes
  * higher level index based interface.
+ *
+ * The pixels are stored in a single contiguous buffer, row after row. Each
+ * row is an array of 64-bit words, `getStride()' words long. Within a word,
+ * the leftmost pixel is held by the least significant bit, so that byte N of
+ * a row (in little endian order) corresponds to the Nth display segment.
+ * Bits beyond the width of the screen are always kept cleared.
+ *
+ * The rows may be longer than the width requires. The capacity grows
+ * geometrically, so that growing the screen pixel by pixel takes amortized
+ * constant time, and it can be reserved up front with reserve().
+ *
+ * The buffer is kHeight pixels high, unless a greater height is given, eg.
+ * for a grid of several rows of display segments. Columns of pixels are
+ * packed in bytes, so the column based operations only access the top
+ * kHeight rows; shifting the columns moves the pixels of all the rows.
  */
 class ScreenBuffer
 {
 
     public:
+    /** The height of a display segment, and the default height. */
     constexpr static unsigned int kHeight = 8U;
 
+    /** Type of a single storage word. */
+    using Word = BitBlit::Word;
+
+    /** Number of pixels stored in a single word. */
+    constexpr static unsigned int kWordBits = BitBlit::kWordBits;
+
     /**
      * Constructs a new object with the given width.
      *
-     * @param[in] width Initial width of the screen, in pixels. This may
-     *                  grow if putBitExpanding() is used.
+     * @param[in] width  Initial width of the screen, in pixels. This may
+     *                   grow if putBitExpanding() is used.
+     * @param[in] height The height of the screen, in pixels.
      */
-    explicit ScreenBuffer(unsigned int width)
-        : mWidth(width), mSegmentCnt(width / 8U)
+    explicit ScreenBuffer(unsigned int width, unsigned int height = kHeight)
+        : mWidth(width), mHeight(height), mSegmentCnt(width / 8U)
     {
         if (width % 8U != 0U) {
             throw std::invalid_argument("The width must be divisible by 8");
         }
 
-        /* Setup screen buffer matrix */
-        mBuffer.resize(kHeight);
-        for (auto &row : mBuffer) {
-            row.resize(mSegmentCnt);
+        if (height == 0U || height % 8U != 0U) {
+            throw std::invalid_argument("The height must be divisible by 8");
         }
+
+        /* Setup screen buffer matrix */
+        mStride = getWordCnt(mSegmentCnt);
+        mWords.resize(mHeight * mStride);
     }
 
     /**
@@ -42,11 +72,52 @@ class ScreenBuffer
      *
      * @return The width of the display row, in bytes.
      */
-    unsigned int getSegmentCnt()
+    unsigned int getSegmentCnt() const
     {
         return mSegmentCnt;
     }
 
+    /**
+     * Returns the height of the screen.
+     *
+     * @return The height, in pixels.
+     */
+    unsigned int getHeight() const
+    {
+        return mHeight;
+    }
+
+    /**
+     * Returns number of words used to store a single row, which may be more
+     * than the width requires.
+     *
+     * @return The distance between two rows, in words.
+     */
+    unsigned int getStride() const
+    {
+        return mStride;
+    }
+
+    /**
+     * Exposes the words holding a single row of pixels.
+     *
+     * @param[in] y The display row.
+     *
+     * @return Pointer to the first of `getStride()' words of the row.
+     */
+    Word *row(unsigned int y)
+    {
+        return mWords.data() + y * mStride;
+    }
+
+    /**
+     * @see row()
+     */
+    const Word *row(unsigned int y) const
+    {
+        return mWords.data() + y * mStride;
+    }
+
     /**
      * Exposes low level bits. Useful when they are equivalent to the
      * hardware representation, so that they can be simply copied to the
@@ -57,9 +128,10 @@ class ScreenBuffer
      *
      * @return The asked byte.
      */
-    uint8_t raw(unsigned int y, unsigned int segment)
+    uint8_t raw(unsigned int y, unsigned int segment) const
     {
-        return mBuffer[y][segment];
+        auto word = row(y)[segment / 8U];
+        return static_cast<uint8_t>(word >> (segment % 8U * 8U));
     }
 
     /**
@@ -67,9 +139,7 @@ class ScreenBuffer
      */
     void clear()
     {
-        for (auto &row : mBuffer) {
-            std::fill(row.begin(), row.end(), 0U);
-        }
+        std::fill(mWords.begin(), mWords.end(), 0U);
     }
 
     /**
@@ -78,7 +148,7 @@ class ScreenBuffer
      */
     void dump()
     {
-        for (auto y = 0U; y < kHeight; y++) {
+        for (auto y = 0U; y < mHeight; y++) {
             for (auto x = 0U; x < mWidth; x++) {
                 bool set = getBit(x, y);
                 std::cout << (set ? 'X' : '-');
@@ -98,17 +168,52 @@ class ScreenBuffer
      */
     uint8_t getColumn(unsigned int x)
     {
-        auto ind     = getIndex(x);
-        uint8_t mask = getMask(x);
-        uint8_t col  = 0U;
+        auto ind    = getIndex(x);
+        Word mask   = getMask(x);
+        uint8_t col = 0U;
 
-        for (auto &row : mBuffer) {
-            insertShifted(&col, (row[ind] & mask) != 0U);
+        if (ind >= mStride) {
+            return 0U;
+        }
+
+        for (auto y = 0U; y < kHeight; y++) {
+            insertShifted(&col, (row(y)[ind] & mask) != 0U);
         }
 
         return col;
     }
 
+    /**
+     * Returns consecutive columns of pixels, each packed in a byte. Columns
+     * outside of the buffer are returned as cleared.
+     *
+     * @param[in]  x       The X coordinate of the first column.
+     * @param[in]  cnt     The number of columns.
+     * @param[out] columns The array receiving `cnt' columns.
+     */
+    void getColumns(unsigned int x, unsigned int cnt, uint8_t *columns) const
+    {
+        std::fill(columns, columns + cnt, 0U);
+
+        for (auto y = 0U; y < kHeight; y++) {
+            for (auto i = 0U; i < cnt; i += kWordBits) {
+                auto n    = (cnt - i < kWordBits) ? cnt - i : kWordBits;
+                Word bits = BitBlit::load(row(y), mStride, x + i);
+
+                if (n < kWordBits) {
+                    bits &= ~(~Word{0U} << n);
+                }
+
+                /* Visit only the pixels that are set */
+                while (bits != 0U) {
+                    auto bit = static_cast<unsigned int>(__builtin_ctzll(bits));
+                    columns[i + bit] |= static_cast<uint8_t>(1U << y);
+                    bits &= bits - 1U;
+                }
+            }
+        }
+    }
+
     /**
      * Modifies state of bit at point x,y.
      *
@@ -118,11 +223,9 @@ class ScreenBuffer
      */
     void putBit(unsigned int x, unsigned int y, bool bit)
     {
-        auto ind = getIndex(x);
-
-        if (y < mBuffer.size() && ind < mBuffer[y].size()) {
-            uint8_t *byte = &(mBuffer[y][ind]);
-            bit ? setBit(byte, x) : resetBit(byte, x);
+        if (y < mHeight && x < mSegmentCnt * 8U) {
+            Word *word = &row(y)[getIndex(x)];
+            bit ? setBit(word, x) : resetBit(word, x);
         }
     }
 
@@ -137,14 +240,9 @@ class ScreenBuffer
      */
     void putBitExpanding(unsigned int x, unsigned int y, bool bit)
     {
-        auto ind = getIndex(x);
-
         /** Dynamically increase internal buffer size, if needed */
-        if (y < mBuffer.size() && ind >= mBuffer[y].size()) {
-            mSegmentCnt++;
-            for (auto &row : mBuffer) {
-                row.resize(ind + 1U);
-            }
+        if (y < mHeight && x >= mSegmentCnt * 8U) {
+            resize(x / 8U + 1U);
         }
 
         putBit(x, y, bit);
@@ -159,17 +257,102 @@ class ScreenBuffer
      * @retval false The point was not set, or point is outside of the display
      *               coordinates.
      */
-    bool getBit(unsigned int x, unsigned int y)
+    bool getBit(unsigned int x, unsigned int y) const
     {
-        auto ind = getIndex(x);
-
-        if (y < mBuffer.size() && ind < mBuffer[y].size()) {
-            return (mBuffer[y][ind] & getMask(x)) != 0U;
+        if (y < mHeight && x < mSegmentCnt * 8U) {
+            return (row(y)[getIndex(x)] & getMask(x)) != 0U;
         }
 
         return false;
     }
 
+    /**
+     * Sets the column of pixels at the given coordinate.
+     *
+     * @param[in] x      The X coordinate of the column.
+     * @param[in] column The column of pixels, packed in a byte.
+     */
+    void putColumn(unsigned int x, uint8_t column)
+    {
+        if (x >= mSegmentCnt * 8U) {
+            return;
+        }
+
+        auto ind  = getIndex(x);
+        auto mask = getMask(x);
+
+        for (auto y = 0U; y < kHeight; y++) {
+            Word *word = &row(y)[ind];
+            *word      = ((column >> y) & 0x1U) ? (*word | mask)
+                                                 : (*word & ~mask);
+        }
+    }
+
+    /**
+     * Sets consecutive columns of pixels, eight columns at a time. Columns
+     * outside of the buffer are ignored.
+     *
+     * @param[in] x       The X coordinate of the first column.
+     * @param[in] cnt     The number of columns.
+     * @param[in] columns The array holding `cnt' columns, packed in bytes.
+     */
+    void putColumns(unsigned int x, unsigned int cnt, const uint8_t *columns)
+    {
+        cnt = clip(cnt, x, mSegmentCnt * 8U);
+
+        for (auto i = 0U; i < cnt; i += kWordBits) {
+            auto n             = (cnt - i < kWordBits) ? cnt - i : kWordBits;
+            Word rows[kHeight] = {};
+
+            for (auto block = 0U; block < n; block += 8U) {
+                Word matrix = 0U;
+                for (auto j = 0U; j < 8U && block + j < n; j++) {
+                    matrix |= Word{columns[i + block + j]} << (j * 8U);
+                }
+
+                matrix = BitBlit::transpose8x8(matrix);
+                for (auto y = 0U; y < kHeight; y++) {
+                    rows[y] |= ((matrix >> (y * 8U)) & 0xFFU) << block;
+                }
+            }
+
+            for (auto y = 0U; y < kHeight; y++) {
+                BitBlit::blitRow(
+                    row(y), x + i, &rows[y], 1U, 0U, n, BitBlit::Op::copy);
+            }
+        }
+    }
+
+    /**
+     * Increases the width of the buffer, keeping its content. The buffer
+     * never shrinks.
+     *
+     * @param[in] width The minimal width of the buffer, in pixels.
+     */
+    void expand(unsigned int width)
+    {
+        auto segmentCnt = (width + 7U) / 8U;
+
+        if (segmentCnt > mSegmentCnt) {
+            resize(segmentCnt);
+        }
+    }
+
+    /**
+     * Makes room for the screen to grow to the given width without further
+     * memory allocation. The width of the screen is not changed.
+     *
+     * @param[in] width The width to reserve room for, in pixels.
+     */
+    void reserve(unsigned int width)
+    {
+        auto stride = getWordCnt((width + 7U) / 8U);
+
+        if (stride > mStride) {
+            relayout(stride);
+        }
+    }
+
     /**
      * Inserts column of bits to the right of the display, shifting the
      * contents of the display one pixel to the left.
@@ -182,51 +365,218 @@ class ScreenBuffer
      */
     uint8_t shiftLeft(uint8_t column)
     {
-        uint8_t ret = 0U;
+        uint8_t ret = getColumn(0U);
 
-        for (auto row = 0U; row < mBuffer.size(); row++) {
-            insertShifted(&ret, getCarry(mBuffer[row][0U]));
+        shiftColumnsLeft(1U);
+        putColumn(mSegmentCnt * 8U - 1U, column);
 
-            for (auto seg = 0U; seg < mSegmentCnt; seg++) {
-                bool carry = (seg < mSegmentCnt - 1U)
-                                 ? getCarry(mBuffer[row][seg + 1U])
-                                 : getCarry(column);
+        return ret;
+    }
 
-                insertShifted(&mBuffer[row][seg], carry);
-            }
+    /**
+     * Shifts the contents of the display to the left by the given number
+     * of columns. The columns shifted in from the right are cleared.
+     *
+     * @param[in] cnt The number of columns to shift by.
+     */
+    void shiftColumnsLeft(unsigned int cnt)
+    {
+        for (auto y = 0U; y < mHeight; y++) {
+            BitBlit::shiftRowLeft(row(y), mStride, cnt);
+        }
+    }
+
+    /**
+     * Combines a rectangular region of the source buffer into this buffer.
+     * The region is clipped to both buffers. The source may be this buffer,
+     * in which case the regions may overlap.
+     *
+     * @param[in] src    The source buffer.
+     * @param[in] srcX   The X coordinate of the source region.
+     * @param[in] srcY   The Y coordinate of the source region.
+     * @param[in] width  The width of the region, in pixels.
+     * @param[in] height The height of the region, in pixels.
+     * @param[in] dstX   The X coordinate of the destination region.
+     * @param[in] dstY   The Y coordinate of the destination region.
+     * @param[in] op     The operation used to combine the pixels.
+     */
+    void blit(const ScreenBuffer &src,
+              unsigned int srcX,
+              unsigned int srcY,
+              unsigned int width,
+              unsigned int height,
+              unsigned int dstX,
+              unsigned int dstY,
+              BitBlit::Op op = BitBlit::Op::copy)
+    {
+        width  = clip(clip(width, srcX, src.mSegmentCnt * 8U),
+                     dstX,
+                     mSegmentCnt * 8U);
+        height = clip(clip(height, srcY, src.mHeight), dstY, mHeight);
+
+        /* Moving down within the same buffer must go from bottom to top */
+        bool reverse = &src == this && dstY > srcY;
+
+        for (auto i = 0U; i < height; i++) {
+            auto dy = reverse ? height - i - 1U : i;
+            BitBlit::blitRow(row(dstY + dy),
+                             dstX,
+                             src.row(srcY + dy),
+                             src.mStride,
+                             srcX,
+                             width,
+                             op);
+        }
+    }
+
+    /**
+     * Sets or clears all the pixels of a rectangular region. The region is
+     * clipped to the buffer.
+     *
+     * @param[in] x      The X coordinate of the region.
+     * @param[in] y      The Y coordinate of the region.
+     * @param[in] width  The width of the region, in pixels.
+     * @param[in] height The height of the region, in pixels.
+     * @param[in] pixel  True to set the pixels, false to clear them.
+     */
+    void fill(unsigned int x,
+              unsigned int y,
+              unsigned int width,
+              unsigned int height,
+              bool pixel)
+    {
+        width  = clip(width, x, mSegmentCnt * 8U);
+        height = clip(height, y, mHeight);
 
-            column >>= 1U;
+        for (auto i = 0U; i < height; i++) {
+            BitBlit::fillRow(row(y + i), x, width, pixel);
         }
+    }
 
-        return ret;
+    /**
+     * Inverts all the pixels of a rectangular region. The region is clipped
+     * to the buffer.
+     *
+     * @param[in] x      The X coordinate of the region.
+     * @param[in] y      The Y coordinate of the region.
+     * @param[in] width  The width of the region, in pixels.
+     * @param[in] height The height of the region, in pixels.
+     */
+    void invert(unsigned int x,
+                unsigned int y,
+                unsigned int width,
+                unsigned int height)
+    {
+        width  = clip(width, x, mSegmentCnt * 8U);
+        height = clip(height, y, mHeight);
+
+        for (auto i = 0U; i < height; i++) {
+            BitBlit::invertRow(row(y + i), x, width);
+        }
     }
 
     private:
     /**
      * Vector used to store display buffer. Individual points (pixels) are
-     * packed into byte, 8 points per byte.
+     * packed into 64-bit words, with rows following each other.
      */
-    std::vector<std::vector<uint8_t>> mBuffer;
+    std::vector<Word> mWords;
 
     /**
      * The width of the display, in pixels.
      */
     unsigned int mWidth;
 
+    /** The height of the display, in pixels. */
+    unsigned int mHeight;
+
     /** Number of display segments. */
     unsigned int mSegmentCnt;
 
+    /** Number of words in a single row. */
+    unsigned int mStride = 0U;
+
+    /**
+     * Returns the number of words needed to hold the given number of
+     * segments.
+     *
+     * @param[in] segmentCnt The number of segments.
+     *
+     * @return The number of words.
+     */
+    static unsigned int getWordCnt(unsigned int segmentCnt)
+    {
+        return (segmentCnt + 7U) / 8U;
+    }
+
+    /**
+     * Clips the length of a span so that it fits within the given limit.
+     *
+     * @param[in] length The length of the span.
+     * @param[in] start  The start of the span.
+     * @param[in] limit  The end of the available space.
+     *
+     * @return The clipped length.
+     */
+    static unsigned int
+    clip(unsigned int length, unsigned int start, unsigned int limit)
+    {
+        if (start >= limit) {
+            return 0U;
+        }
+
+        return std::min(length, limit - start);
+    }
+
+    /**
+     * Grows the number of segments, keeping the content of the buffer.
+     *
+     * @param[in] segmentCnt The new number of segments, must not be less
+     *                       than the current one.
+     */
+    void resize(unsigned int segmentCnt)
+    {
+        auto stride = getWordCnt(segmentCnt);
+
+        /* Grow geometrically, so that the relayouts are amortized */
+        if (stride > mStride) {
+            relayout(std::max(stride, 2U * mStride));
+        }
+
+        mSegmentCnt = segmentCnt;
+        mWidth      = segmentCnt * 8U;
+    }
+
+    /**
+     * Moves the rows to a buffer with the given stride, keeping their
+     * content.
+     *
+     * @param[in] stride The new number of words in a single row, must not
+     *                   be less than the current one.
+     */
+    void relayout(unsigned int stride)
+    {
+        std::vector<Word> words(mHeight * stride);
+
+        for (auto y = 0U; y < mHeight; y++) {
+            std::copy(row(y), row(y) + mStride, &words[y * stride]);
+        }
+
+        mWords  = std::move(words);
+        mStride = stride;
+    }
+
     /**
      * Maps horizontal coordinate of a pixel to an array index.
      *
      * @param[in] x The horizontal coordinate of a pixel.
      *
-     * @return Index of an element in row buffer containing the value of
+     * @return Index of a word in the row buffer containing the value of
      * Xth pixel.
      */
-    uint8_t getIndex(unsigned int x)
+    static unsigned int getIndex(unsigned int x)
     {
-        return x / 8U;
+        return x / kWordBits;
     }
 
     /**
@@ -235,11 +585,11 @@ class ScreenBuffer
      *
      * @param[in] x The horizontal coordinate of a pixel.
      *
-     * @return Byte sized bitmap that selects corresponding pixel.
+     * @return Word sized bitmap that selects corresponding pixel.
      */
-    uint8_t getMask(unsigned int x)
+    static Word getMask(unsigned int x)
     {
-        return 1U << (x % 8U);
+        return Word{1U} << (x % kWordBits);
     }
 
     /**
@@ -248,46 +598,31 @@ class ScreenBuffer
      * @param[in] byte   Pointer to the byte where point is to be inserted.
      * @param[in] insert The value of the point.
      */
-    void insertShifted(uint8_t *byte, bool insert)
+    static void insertShifted(uint8_t *byte, bool insert)
     {
-        *byte = (*byte >> 1U) | (insert << 7U);
+        *byte = static_cast<uint8_t>((*byte >> 1U) | (insert << 7U));
     }
 
     /**
-     * Get bit that would be pushed out if `insertShifted` were to be called
-     * on the same bytee.
-     *
-     * @param[in] byte The pointer to the byte.
+     * Sets Nth bit in word to 1. N is wrapped by mod 64.
      *
-     * @return Value of the point.
-     */
-    bool getCarry(uint8_t byte)
-    {
-        return (byte & 0x1U) != 0U;
-    }
-
-    /**
-     * Sets Nth bit in byte to 0. If N is greater than 8, it is wrapped by mod
-     * 8.
-     *
-     * @param[in] byte  The pointer to the byte.
+     * @param[in] word  The pointer to the word.
      * @param[in] pixel Index of the bit to be set.
      */
-    void setBit(uint8_t *byte, unsigned int pixel)
+    static void setBit(Word *word, unsigned int pixel)
     {
-        *byte |= getMask(pixel);
+        *word |= getMask(pixel);
     }
 
     /**
-     * Sets Nth bit in byte to 1. If N is greater than 8, it is wrapped by mod
-     * 8.
+     * Sets Nth bit in word to 0. N is wrapped by mod 64.
      *
-     * @param[in] byte  The pointer to the byte.
-     * @param[in] pixel Index of the bit to be set.
+     * @param[in] word  The pointer to the word.
+     * @param[in] pixel Index of the bit to be reset.
      */
-    void resetBit(uint8_t *byte, unsigned int pixel)
+    static void resetBit(Word *word, unsigned int pixel)
     {
-        *byte &= ~getMask(pixel);
+        *word &= ~getMask(pixel);
     }
 };
 
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <vector>
 
 #include "device/display/display-base.hpp"
+#include "util/column-source.hpp"
 #include "util/screenbuffer.hpp"
 
 namespace Util
@@ -17,6 +19,9 @@ namespace Util
 class ScrollingDisplay : public Device::Display::DisplayBase
 {
     public:
+    /** Columns of a virtual display, one byte per column, shared. */
+    using Strip = std::shared_ptr<const std::vector<uint8_t>>;
+
     /**
      * Creates a new scrolling display.
      *
@@ -33,7 +38,8 @@ class ScrollingDisplay : public Device::Display::DisplayBase
      * This method needs to be called repeatedly to create the illusion of
      * scrolling contents within the underlying physical display. The method
      * will also call refresh(), so the separate call to refresh the display is
-     * not needed.
+     * not needed. The physical display is flushed once the contents has
+     * been fully shown.
      *
      * @retval true  The contents of the virtual display has not scrolled fully.
      *               The user should continue to call this method in a loop.
@@ -42,17 +48,117 @@ class ScrollingDisplay : public Device::Display::DisplayBase
      */
     bool slideIn()
     {
-        mPhyDisp->shiftLeft(mBuffer.getColumn(mNextX));
+        if (mSource != nullptr) {
+            return slideInStream();
+        }
+
+        if (!mStripValid) {
+            buildStrip();
+        }
+
+        mPhyDisp->shiftLeft((*mStrip)[mNextX]);
 
         refresh();
 
         if (mNextX++ == mWidth) {
             mNextX = 0U;
+            flush();
         }
 
         return mNextX != 0U;
     }
 
+    /**
+     * Shows the virtual display on the physical display in place, starting
+     * at its left edge, without scrolling. The physical display is refreshed
+     * and flushed.
+     */
+    void present()
+    {
+        const auto &strip = getStrip();
+
+        mPhyDisp->clear();
+        mPhyDisp->blitColumns(
+            0U, strip->data(), static_cast<unsigned int>(strip->size()));
+        refresh();
+        flush();
+    }
+
+    /**
+     * Returns the columns of the virtual display, one byte per column. The
+     * strip is shared rather than copied; it is not modified afterwards, as
+     * the display builds a new one if it changes while still shared.
+     *
+     * @return The column strip.
+     */
+    const Strip &getStrip()
+    {
+        if (!mStripValid) {
+            buildStrip();
+        }
+
+        return mStrip;
+    }
+
+    /**
+     * Replaces the contents of the virtual display with the given columns,
+     * typically obtained earlier through getStrip(). The columns are shared,
+     * not copied, and must not change unless adopted again afterwards. The
+     * scrolling restarts from the beginning.
+     *
+     * @param[in] strip The columns, one byte per column, or nullptr.
+     */
+    void adoptStrip(Strip strip)
+    {
+        if (!strip || strip->empty()) {
+            clear();
+            return;
+        }
+
+        mSource      = nullptr;
+        mWidth       = static_cast<unsigned int>(strip->size()) - 1U;
+        mStrip       = std::move(strip);
+        mStripValid  = true;
+        mBufferStale = true;
+        mNextX       = 0U;
+    }
+
+    /**
+     * Replaces the contents of the virtual display with the columns produced
+     * by the source, which are only produced as the scrolling advances.
+     * Only a fixed number of columns ahead of the physical display is kept,
+     * so the memory used and the time to start do not depend on the width
+     * of the contents. The scrolling restarts from the beginning.
+     *
+     * The streamed contents are only shown by slideIn(). The streaming ends
+     * by calling clear() or adoptStrip().
+     *
+     * @param[in] source The source of the columns, must outlive the
+     *                   streaming.
+     */
+    void stream(ColumnSource *source)
+    {
+        clear();
+
+        source->rewind();
+        mSource = source;
+        mAhead.resize(std::size_t{kAheadCnt});
+        mAheadPos = 0U;
+        mAheadCnt = 0U;
+    }
+
+    /**
+     * Makes room for contents of the given width, so that drawing it does
+     * not need to grow the virtual display step by step.
+     *
+     * @param[in] width The width of the contents, in pixels.
+     */
+    void reserve(unsigned int width)
+    {
+        mBuffer.reserve(width);
+        ownStrip().reserve(width);
+    }
+
     /**
      * Refreshes the screen.
      */
@@ -61,6 +167,14 @@ class ScrollingDisplay : public Device::Display::DisplayBase
         mPhyDisp->refresh();
     }
 
+    /**
+     * Flushes the physical display.
+     */
+    void flush() override
+    {
+        mPhyDisp->flush();
+    }
+
     /**
      * Sets the virtual display width to the zero, clearing internal buffers.
      * The display refresh() method is not called and must be called
@@ -69,9 +183,13 @@ class ScrollingDisplay : public Device::Display::DisplayBase
     void clear() override
     {
         mBuffer.clear();
+        mStrip.reset();
 
-        mWidth = 0U;
-        mNextX = 0U;
+        mWidth       = 0U;
+        mNextX       = 0U;
+        mStripValid  = false;
+        mBufferStale = false;
+        mSource      = nullptr;
     }
 
     /**
@@ -83,6 +201,9 @@ class ScrollingDisplay : public Device::Display::DisplayBase
      */
     void putPixel(unsigned int x, unsigned int y, bool pixel) override
     {
+        syncBuffer();
+        mStripValid = false;
+
         /** Dynamically increase internal buffer size, if needed */
         if (x >= mWidth) {
             mWidth = x;
@@ -114,6 +235,45 @@ class ScrollingDisplay : public Device::Display::DisplayBase
         putPixel(x, y, false);
     }
 
+    /**
+     * Sets the column of pixels at given coordinate.
+     *
+     * @param[in] x      The x coordinate, zero based.
+     * @param[in] column The column of pixels, packed in a byte.
+     */
+    void putColumn(unsigned int x, uint8_t column) override
+    {
+        blitColumns(x, &column, 1U);
+    }
+
+    /**
+     * Sets consecutive columns of pixels, growing the virtual display if
+     * needed.
+     *
+     * @param[in] x       The x coordinate of the first column, zero based.
+     * @param[in] columns The columns of pixels, packed in bytes.
+     * @param[in] cnt     The number of columns.
+     */
+    void blitColumns(unsigned int x,
+                     const uint8_t *columns,
+                     unsigned int cnt) override
+    {
+        if (cnt == 0U) {
+            return;
+        }
+
+        syncBuffer();
+
+        auto last = x + cnt - 1U;
+        if (last >= mWidth) {
+            mWidth = last;
+            mBuffer.expand(last + 1U);
+        }
+
+        mBuffer.putColumns(x, cnt, columns);
+        mStripValid = false;
+    }
+
     /**
      * Inserts the column to the virtual display, shifting the content of the
      * display one pixel to the left.
@@ -128,6 +288,93 @@ class ScrollingDisplay : public Device::Display::DisplayBase
     }
 
     private:
+    /**
+     * Builds the column-major copy of the virtual display, one byte per
+     * column, so that the animation does not need to assemble the columns
+     * from the screen buffer rows on every frame.
+     */
+    void buildStrip()
+    {
+        mStrip.reset();
+
+        auto &strip = ownStrip();
+        strip.resize(mWidth + 1U);
+        mBuffer.getColumns(0U, mWidth + 1U, strip.data());
+
+        mStrip      = mOwnStrip;
+        mStripValid = true;
+    }
+
+    /**
+     * Returns the strip owned by the display, for it to be built. Its
+     * storage is reused, unless the strip is still shared with someone
+     * else, in which case a new one is made.
+     *
+     * @return The strip.
+     */
+    std::vector<uint8_t> &ownStrip()
+    {
+        if (!mOwnStrip || mOwnStrip.use_count() != 1) {
+            mOwnStrip = std::make_shared<std::vector<uint8_t>>();
+        }
+
+        return *mOwnStrip;
+    }
+
+    /**
+     * Slides in the next column produced by the streaming source.
+     *
+     * @return See slideIn().
+     */
+    bool slideInStream()
+    {
+        if (mAheadPos == mAheadCnt) {
+            readAhead();
+        }
+
+        /* Empty contents still take a single blank column, as a strip does */
+        uint8_t column = mAheadPos < mAheadCnt ? mAhead[mAheadPos++] : 0U;
+        mPhyDisp->shiftLeft(column);
+
+        refresh();
+
+        if (mAheadPos == mAheadCnt) {
+            readAhead();
+        }
+
+        if (mAheadCnt != 0U) {
+            return true;
+        }
+
+        mSource->rewind();
+        flush();
+        return false;
+    }
+
+    /**
+     * Produces the next batch of streamed columns.
+     */
+    void readAhead()
+    {
+        mAheadCnt = mSource->read(mAhead.data(), kAheadCnt);
+        mAheadPos = 0U;
+    }
+
+    /**
+     * Loads the screen buffer from the strip, if the strip was adopted.
+     */
+    void syncBuffer()
+    {
+        if (!mBufferStale) {
+            return;
+        }
+
+        mBuffer.clear();
+        mBuffer.expand(mWidth + 1U);
+        mBuffer.putColumns(0U, mWidth + 1U, mStrip->data());
+        mBufferStale = false;
+    }
+
     /**
      * Pointer to the actual display that displays the data.
      */
@@ -148,6 +395,33 @@ class ScrollingDisplay : public Device::Display::DisplayBase
      * Screen buffer.
      */
     ScreenBuffer mBuffer;
+
+    /** Columns of the virtual display, valid if mStripValid is true. */
+    Strip mStrip;
+
+    /** The strip built by the display, shared through mStrip. */
+    std::shared_ptr<std::vector<uint8_t>> mOwnStrip;
+
+    /** False if the screen buffer has changed since the strip was built. */
+    bool mStripValid = false;
+
+    /** True if the strip was adopted and the screen buffer is outdated. */
+    bool mBufferStale = false;
+
+    /** Number of streamed columns produced at once. */
+    static const unsigned int kAheadCnt = 64U;
+
+    /** The source of the streamed contents, nullptr if not streaming. */
+    ColumnSource *mSource = nullptr;
+
+    /** Streamed columns produced, but not shown yet. */
+    std::vector<uint8_t> mAhead;
+
+    /** Index of the next column in mAhead. */
+    unsigned int mAheadPos = 0U;
+
+    /** Number of valid columns in mAhead. */
+    unsigned int mAheadCnt = 0U;
 };
 
 } // namespace Util
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace Util
+{
+
+/**
+ * Bounded, lock-free queue for exactly one producer thread and one consumer
+ * thread. The slots are allocated once, at construction, and are filled in
+ * place, so that passing an element does not allocate memory.
+ *
+ * The producer obtains a free slot with acquire(), fills it and hands it to
+ * the consumer with publish(). The consumer reads the oldest slot through
+ * front() and releases it with pop().
+ */
+template <typename T> class SpscRing
+{
+    public:
+    /**
+     * Constructs the ring.
+     *
+     * @param[in] capacity The maximal number of queued elements.
+     * @param[in] value    The initial value of the slots.
+     */
+    explicit SpscRing(std::size_t capacity, const T &value = T())
+        : mSlots(capacity + 1U, value)
+    {
+    }
+
+    /**
+     * Returns the slot to be filled by the producer.
+     *
+     * @return The slot, or nullptr if the ring is full.
+     */
+    T *acquire()
+    {
+        auto head = mHead.load(std::memory_order_relaxed);
+        if (next(head) == mTail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        return &mSlots[head];
+    }
+
+    /**
+     * Hands the slot obtained by acquire() over to the consumer.
+     */
+    void publish()
+    {
+        auto head = mHead.load(std::memory_order_relaxed);
+        mHead.store(next(head), std::memory_order_release);
+    }
+
+    /**
+     * Returns the oldest queued element to the consumer.
+     *
+     * @return The element, or nullptr if the ring is empty.
+     */
+    T *front()
+    {
+        auto tail = mTail.load(std::memory_order_relaxed);
+        if (tail == mHead.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        return &mSlots[tail];
+    }
+
+    /**
+     * Releases the element obtained by front(), making its slot available
+     * to the producer.
+     */
+    void pop()
+    {
+        auto tail = mTail.load(std::memory_order_relaxed);
+        mTail.store(next(tail), std::memory_order_release);
+    }
+
+    /**
+     * Returns the number of queued elements. The value is only a snapshot
+     * when called concurrently with the other thread.
+     *
+     * @return The number of elements.
+     */
+    std::size_t depth() const
+    {
+        auto head = mHead.load(std::memory_order_acquire);
+        auto tail = mTail.load(std::memory_order_acquire);
+
+        return head >= tail ? head - tail : head + mSlots.size() - tail;
+    }
+
+    /**
+     * Returns the maximal number of queued elements.
+     *
+     * @return The capacity.
+     */
+    std::size_t capacity() const
+    {
+        return mSlots.size() - 1U;
+    }
+
+    private:
+    /**
+     * Returns the index of the slot following the given one.
+     */
+    std::size_t next(std::size_t index) const
+    {
+        return index + 1U == mSlots.size() ? 0U : index + 1U;
+    }
+
+    /** The slots, one more than the capacity to tell full from empty. */
+    std::vector<T> mSlots;
+
+    /** Index of the next slot to be published, written by the producer. */
+    alignas(64) std::atomic<std::size_t> mHead{0U};
+
+    /** Index of the oldest queued slot, written by the consumer. */
+    alignas(64) std::atomic<std::size_t> mTail{0U};
+};
+
+} // namespace Util
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cinttypes>
+#include <list>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+
+#include "util/metrics.hpp"
+#include "util/painter.hpp"
+#include "util/scrolling-display.hpp"
+
+namespace Util
+{
+
+/**
+ * Small least recently used cache of rendered text, keyed by the font and
+ * the text. Each entry shares the column strip of a ScrollingDisplay, so that
+ * the text can be shown again without rendering it glyph by glyph, nor
+ * copying the strip.
+ */
+class StripCache
+{
+    public:
+    /**
+     * Constructs a new cache.
+     *
+     * @param[in] capacity The maximal number of cached strips.
+     */
+    explicit StripCache(std::size_t capacity = 8U) : mCapacity(capacity)
+    {
+    }
+
+    /**
+     * Shows the text on the scrolling display, starting at the left edge.
+     * The previous contents of the display is cleared. The text is rendered
+     * only if it is not found in the cache.
+     *
+     * @tparam Font The font class.
+     * @param[out] display The display where the text is to be shown.
+     * @param[in]  text    The text to show.
+     */
+    template <typename Font>
+    void render(ScrollingDisplay *display, const std::string &text)
+    {
+        std::type_index font = typeid(Font);
+        auto strip           = find(font, text);
+
+        if (strip) {
+            mHits++;
+            DOTCLOCK_METRICS_ADD(stripCacheHits, 1U);
+            display->adoptStrip(std::move(strip));
+            return;
+        }
+
+        mMisses++;
+        DOTCLOCK_METRICS_ADD(stripCacheMisses, 1U);
+        display->clear();
+        display->reserve(Painter::measureText<Font>(text));
+        Painter::writeText<Font>(display, 0U, 0U, text);
+        insert(font, text, display->getStrip());
+    }
+
+    /**
+     * Returns number of render() calls that were served from the cache.
+     *
+     * @return The number of hits.
+     */
+    unsigned long getHits() const
+    {
+        return mHits;
+    }
+
+    /**
+     * Returns number of render() calls that needed to render the text.
+     *
+     * @return The number of misses.
+     */
+    unsigned long getMisses() const
+    {
+        return mMisses;
+    }
+
+    private:
+    /** A single cached strip. */
+    struct Entry {
+        std::type_index font;
+        std::string text;
+        ScrollingDisplay::Strip strip;
+    };
+
+    /**
+     * Looks up the strip, marking it as the most recently used one.
+     *
+     * @param[in] font The font of the text.
+     * @param[in] text The text.
+     *
+     * @return The strip, or nullptr if it is not cached.
+     */
+    ScrollingDisplay::Strip find(std::type_index font, const std::string &text)
+    {
+        for (auto it = mEntries.begin(); it != mEntries.end(); it++) {
+            if (it->font == font && it->text == text) {
+                mEntries.splice(mEntries.begin(), mEntries, it);
+                return mEntries.front().strip;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Adds the strip as the most recently used one, evicting the least
+     * recently used strip if the cache is full.
+     *
+     * @param[in] font  The font of the text.
+     * @param[in] text  The text.
+     * @param[in] strip The rendered strip.
+     */
+    void insert(std::type_index font,
+                const std::string &text,
+                const ScrollingDisplay::Strip &strip)
+    {
+        if (mCapacity == 0U) {
+            return;
+        }
+
+        if (mEntries.size() >= mCapacity) {
+            /* Reuse the storage of the evicted entry */
+            mEntries.splice(mEntries.begin(), mEntries, --mEntries.end());
+            mEntries.front().font  = font;
+            mEntries.front().text  = text;
+            mEntries.front().strip = strip;
+            return;
+        }
+
+        mEntries.push_front({font, text, strip});
+    }
+
+    /** The maximal number of cached strips. */
+    std::size_t mCapacity;
+
+    /** Cached strips, the most recently used first. */
+    std::list<Entry> mEntries;
+
+    /** Number of render() calls served from the cache. */
+    unsigned long mHits = 0U;
+
+    /** Number of render() calls that rendered the text. */
+    unsigned long mMisses = 0U;
+};
+
+/**
+ * Shows the text on the scrolling display, starting at the left edge, using
+ * the cache if one is given.
+ *
+ * @tparam Font The font class.
+ * @param[out] display The display where the text is to be shown.
+ * @param[in]  cache   The cache of rendered strips, may be nullptr.
+ * @param[in]  text    The text to show.
+ */
+template <typename Font>
+void renderText(ScrollingDisplay *display,
+                StripCache *cache,
+                const std::string &text)
+{
+    if (cache != nullptr) {
+        cache->render<Font>(display, text);
+        return;
+    }
+
+    display->clear();
+    display->reserve(Painter::measureText<Font>(text));
+    Painter::writeText<Font>(display, 0U, 0U, text);
+}
+
+} // namespace Util
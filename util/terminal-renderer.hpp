@@ -0,0 +1,298 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "util/screenbuffer.hpp"
+
+namespace Util
+{
+
+/**
+ * Shows the content of screen buffers on a terminal, one character per
+ * pixel ('X' when set, '-' otherwise).
+ *
+ * Each frame is built in a single buffer and written with a single system
+ * call. On a terminal, the frame is repainted in place using ANSI escape
+ * sequences, only rewriting the cells that have changed. Frames coming
+ * faster than the terminal can show them are skipped. Their changes are
+ * shown by the next frame that is not skipped, or by a forced one (see
+ * isPending()).
+ *
+ * Otherwise, for example when the output is redirected to a file, every
+ * frame is appended in full, followed by an empty line.
+ */
+class TerminalRenderer
+{
+    public:
+    /** Selects how the frames are written. */
+    enum class Mode {
+        /** Every frame is written in full, after the previous one. */
+        append,
+
+        /** The frame is repainted in place, rewriting the changed cells. */
+        inPlace,
+    };
+
+    /**
+     * Constructs the renderer.
+     *
+     * @param[in] fd          The file descriptor to write to. The mode is
+     *                        inPlace if it refers to a terminal, append
+     *                        otherwise.
+     * @param[in] minInterval The minimal time between two frames written in
+     *                        place.
+     */
+    explicit TerminalRenderer(int fd = STDOUT_FILENO,
+                              std::chrono::milliseconds minInterval =
+                                  std::chrono::milliseconds(16))
+        : TerminalRenderer(fd,
+                           ::isatty(fd) != 0 ? Mode::inPlace : Mode::append,
+                           minInterval)
+    {
+    }
+
+    /**
+     * Constructs the renderer.
+     *
+     * @param[in] fd          The file descriptor to write to.
+     * @param[in] mode        The way the frames are written.
+     * @param[in] minInterval The minimal time between two frames written in
+     *                        place.
+     */
+    TerminalRenderer(int fd, Mode mode, std::chrono::milliseconds minInterval)
+        : mFd(fd), mMode(mode), mMinInterval(minInterval)
+    {
+    }
+
+    /**
+     * Shows the content of the screen buffer.
+     *
+     * @param[in] buffer The screen buffer.
+     * @param[in] force  True to show the frame even if it comes too soon
+     *                   after the previous one.
+     */
+    void render(const ScreenBuffer &buffer, bool force = false)
+    {
+        auto width  = buffer.getSegmentCnt() * 8U;
+        auto height = buffer.getHeight();
+
+        if (mMode == Mode::append) {
+            mOutput.clear();
+            for (auto y = 0U; y < height; y++) {
+                for (auto x = 0U; x < width; x++) {
+                    mOutput += cell(buffer, x, y);
+                }
+                mOutput += '\n';
+            }
+            mOutput += '\n';
+
+            flush();
+            return;
+        }
+
+        auto now = Clock::now();
+        if (!force && mDrawn && now - mLastDraw < mMinInterval) {
+            mSkipped++;
+            mPending = true;
+            return;
+        }
+        mLastDraw = now;
+        mPending  = false;
+
+        if (!mDrawn || width != mWidth || height != mHeight) {
+            drawFull(buffer, width, height);
+        } else {
+            drawChanges(buffer);
+        }
+
+        flush();
+    }
+
+    /**
+     * Returns the number of frames skipped by the throttling.
+     *
+     * @return The number of frames.
+     */
+    unsigned long getSkipped() const
+    {
+        return mSkipped;
+    }
+
+    /**
+     * Checks if the last frame was skipped by the throttling, in which case
+     * the terminal lags behind until the next frame is shown. A frame that
+     * is not followed by another one soon should then be forced.
+     *
+     * @return True if the last frame has not been shown.
+     */
+    bool isPending() const
+    {
+        return mPending;
+    }
+
+    private:
+    using Clock = std::chrono::steady_clock;
+
+    /** The longest run of unchanged cells rewritten rather than skipped. */
+    static const unsigned int kMaxGap = 4U;
+
+    /**
+     * Returns the character showing the pixel.
+     */
+    static char cell(const ScreenBuffer &buffer, unsigned int x, unsigned int y)
+    {
+        return buffer.getBit(x, y) ? 'X' : '-';
+    }
+
+    /**
+     * Draws the whole frame below the cursor, leaving the cursor at the
+     * beginning of the line following the frame.
+     *
+     * @param[in] buffer The screen buffer.
+     * @param[in] width  The width of the screen buffer.
+     * @param[in] height The height of the screen buffer.
+     */
+    void drawFull(const ScreenBuffer &buffer,
+                  unsigned int width,
+                  unsigned int height)
+    {
+        mWidth  = width;
+        mHeight = height;
+        mDrawn  = true;
+        mCells.resize(width * height);
+
+        mOutput.clear();
+        for (auto y = 0U; y < height; y++) {
+            for (auto x = 0U; x < width; x++) {
+                auto &c = mCells[y * width + x];
+                c       = cell(buffer, x, y);
+                mOutput += c;
+            }
+            mOutput += '\n';
+        }
+    }
+
+    /**
+     * Rewrites the cells that differ from the frame drawn last, leaving the
+     * cursor where drawFull() left it.
+     *
+     * @param[in] buffer The screen buffer.
+     */
+    void drawChanges(const ScreenBuffer &buffer)
+    {
+        mOutput.clear();
+
+        /* The cursor starts below the frame, walk its rows top down */
+        appendEscape(mHeight, 'A');
+        auto changed = false;
+
+        for (auto y = 0U; y < mHeight; y++) {
+            auto next = mWidth;
+
+            for (auto x = 0U; x < mWidth; x++) {
+                auto &c = mCells[y * mWidth + x];
+                auto n  = cell(buffer, x, y);
+                if (c == n) {
+                    continue;
+                }
+
+                /* Short gaps are rewritten, as that is shorter than a jump */
+                if (next < x && x - next <= kMaxGap) {
+                    mOutput.append(&mCells[y * mWidth + next], x - next);
+                } else if (x != next) {
+                    appendEscape(x + 1U, 'G');
+                }
+
+                mOutput += n;
+                c       = n;
+                next    = x + 1U;
+                changed = true;
+            }
+
+            mOutput += "\r\n";
+        }
+
+        if (!changed) {
+            mOutput.clear();
+        }
+    }
+
+    /**
+     * Appends the control sequence with a single numeric parameter.
+     *
+     * @param[in] n    The parameter.
+     * @param[in] code The final character of the sequence.
+     */
+    void appendEscape(unsigned int n, char code)
+    {
+        char digits[10];
+        auto cnt = 0U;
+
+        do {
+            digits[cnt++] = static_cast<char>('0' + n % 10U);
+            n /= 10U;
+        } while (n != 0U);
+
+        mOutput += "\x1b[";
+        while (cnt != 0U) {
+            mOutput += digits[--cnt];
+        }
+        mOutput += code;
+    }
+
+    /**
+     * Writes the built output.
+     */
+    void flush()
+    {
+        std::size_t written = 0U;
+
+        while (written < mOutput.size()) {
+            auto ret = ::write(
+                mFd, mOutput.data() + written, mOutput.size() - written);
+            if (ret <= 0) {
+                return;
+            }
+
+            written += static_cast<std::size_t>(ret);
+        }
+    }
+
+    /** The file descriptor written to. */
+    int mFd;
+
+    /** The way the frames are written. */
+    Mode mMode;
+
+    /** The minimal time between two frames written in place. */
+    std::chrono::milliseconds mMinInterval;
+
+    /** The output being built, kept to avoid allocations. */
+    std::string mOutput;
+
+    /** The cells drawn last, row by row. */
+    std::vector<char> mCells;
+
+    /** The width of the frame drawn last. */
+    unsigned int mWidth = 0U;
+
+    /** The height of the frame drawn last. */
+    unsigned int mHeight = 0U;
+
+    /** True if a frame has been drawn in place. */
+    bool mDrawn = false;
+
+    /** The time the last frame was drawn in place. */
+    Clock::time_point mLastDraw;
+
+    /** True if the last frame was skipped by the throttling. */
+    bool mPending = false;
+
+    /** Number of frames skipped by the throttling. */
+    unsigned long mSkipped = 0U;
+};
+
+} // namespace Util
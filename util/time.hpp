@@ -1,18 +1,315 @@
 #pragma once
 
+#include <algorithm>
 #include <ctime>
+#include <functional>
 #include <iomanip>
+#include <list>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace Util
 {
 
-std::string getTime(const std::string &format)
+/**
+ * Formats the current local time, caching the results. Each format is only
+ * formatted again once the time crosses the boundary of the finest field the
+ * format shows (for example a minute for "%H:%M", or a day for "%A %e%b").
+ * The broken-down local time is shared between the formats and recomputed
+ * at most once per second.
+ */
+class TimeService
 {
-    auto t  = std::time(nullptr);
-    auto tm = *std::localtime(&t);
-    std::stringstream ss;
-    ss << std::put_time(&tm, format.c_str());
-    return ss.str();
+    public:
+    /** Source of the current time. */
+    using Source = std::function<std::time_t()>;
+
+    /** Called with the new value when the formatted time changes. */
+    using Listener = std::function<void(const std::string &)>;
+
+    /**
+     * Constructs a new time service.
+     *
+     * @param[in] source The source of the current time.
+     */
+    explicit TimeService(Source source = defaultSource())
+        : mSource(std::move(source))
+    {
+    }
+
+    /**
+     * Returns the service shared by the whole application.
+     *
+     * @return The shared time service.
+     */
+    static TimeService &shared()
+    {
+        static TimeService service;
+        return service;
+    }
+
+    /**
+     * Changes the source of the current time, invalidating cached values.
+     *
+     * @param[in] source The source of the current time.
+     */
+    void setSource(Source source)
+    {
+        mSource = std::move(source);
+        mTmTime = kNever;
+
+        for (auto &entry : mEntries) {
+            entry.validFrom  = kNever;
+            entry.validUntil = kNever;
+        }
+    }
+
+    /**
+     * Returns the current time, formatted according to the std::put_time()
+     * format string.
+     *
+     * @param[in] format The format.
+     *
+     * @return The formatted time.
+     */
+    const std::string &get(const std::string &format)
+    {
+        return update(lookup(format)).value;
+    }
+
+    /**
+     * Returns the number of times the formatted time has changed. Users can
+     * store it to find out whether the time has changed since they last
+     * used it.
+     *
+     * @param[in] format The format.
+     *
+     * @return The revision of the formatted time.
+     */
+    unsigned long getRevision(const std::string &format)
+    {
+        return update(lookup(format)).revision;
+    }
+
+    /**
+     * Registers a listener to be called whenever the formatted time changes.
+     * Listeners are called from get() or getRevision().
+     *
+     * @param[in] format   The format.
+     * @param[in] listener The listener.
+     */
+    void subscribe(const std::string &format, Listener listener)
+    {
+        lookup(format).listeners.push_back(std::move(listener));
+    }
+
+    private:
+    /** The cached state of a single format. */
+    struct Entry {
+        std::string format;
+        std::string value;
+        std::time_t validFrom;
+        std::time_t validUntil;
+        unsigned long revision;
+        std::vector<Listener> listeners;
+    };
+
+    /** The finest field a format shows. */
+    enum class Field { second, minute, hour, day };
+
+    /** Time which is never reached, used for invalid values. */
+    static constexpr std::time_t kNever = -1;
+
+    /**
+     * Returns the std::time() based source.
+     *
+     * @return The source.
+     */
+    static Source defaultSource()
+    {
+        return []() { return std::time(nullptr); };
+    }
+
+    /**
+     * Finds the entry of the format, creating it if needed.
+     *
+     * @param[in] format The format.
+     *
+     * @return The entry.
+     */
+    Entry &lookup(const std::string &format)
+    {
+        for (auto &entry : mEntries) {
+            if (entry.format == format) {
+                return entry;
+            }
+        }
+
+        mEntries.push_back({format, std::string(), kNever, kNever, 0U, {}});
+        return mEntries.back();
+    }
+
+    /**
+     * Formats the entry again if its boundary has been crossed.
+     *
+     * @param[in] entry The entry.
+     *
+     * @return The entry.
+     */
+    Entry &update(Entry &entry)
+    {
+        auto now = mSource();
+
+        /* The time may also go backwards, for example when it is set */
+        if (now >= entry.validFrom && now < entry.validUntil) {
+            return entry;
+        }
+
+        const std::tm &tm = localTime(now);
+
+        entry.validFrom  = now;
+        entry.validUntil = nextBoundary(now, tm, getField(entry.format));
+
+        mStream.str(std::string());
+        mStream << std::put_time(&tm, entry.format.c_str());
+
+        auto value = mStream.str();
+        if (entry.revision != 0U && value == entry.value) {
+            return entry;
+        }
+
+        entry.value = std::move(value);
+        entry.revision++;
+
+        for (auto &listener : entry.listeners) {
+            listener(entry.value);
+        }
+
+        return entry;
+    }
+
+    /**
+     * Returns the broken-down local time, computing it only if the time has
+     * changed since the last call.
+     *
+     * @param[in] now The time.
+     *
+     * @return The broken-down local time.
+     */
+    const std::tm &localTime(std::time_t now)
+    {
+        if (now != mTmTime) {
+            localtime_r(&now, &mTm);
+            mTmTime = now;
+        }
+
+        return mTm;
+    }
+
+    /**
+     * Finds the finest field shown by the format.
+     *
+     * @param[in] format The std::put_time() format.
+     *
+     * @return The field. Unknown conversions are treated as seconds.
+     */
+    static Field getField(const std::string &format)
+    {
+        static const std::string kDay    = "aAbBhdeDFmyYCgGjuwUVWx";
+        static const std::string kHour   = "HIklpPzZ";
+        static const std::string kMinute = "MR";
+        auto field                       = Field::day;
+
+        for (auto i = 0U; i + 1U < format.size(); i++) {
+            if (format[i] != '%') {
+                continue;
+            }
+
+            /* Skip the E and O modifiers */
+            char conv = format[++i];
+            if ((conv == 'E' || conv == 'O') && i + 1U < format.size()) {
+                conv = format[++i];
+            }
+
+            if (conv == '%' || conv == 'n' || conv == 't' ||
+                kDay.find(conv) != std::string::npos) {
+                continue;
+            }
+
+            if (kHour.find(conv) != std::string::npos) {
+                field = std::min(field, Field::hour);
+            } else if (kMinute.find(conv) != std::string::npos) {
+                field = std::min(field, Field::minute);
+            } else {
+                field = Field::second;
+            }
+        }
+
+        return field;
+    }
+
+    /**
+     * Computes the first time at which the field changes.
+     *
+     * @param[in] now   The current time.
+     * @param[in] tm    The broken-down current local time.
+     * @param[in] field The field.
+     *
+     * @return The time of the next change.
+     */
+    static std::time_t
+    nextBoundary(std::time_t now, const std::tm &tm, Field field)
+    {
+        std::time_t minute = now + (60 - std::min(tm.tm_sec, 59));
+
+        switch (field) {
+        case Field::second:
+            return now + 1;
+        case Field::minute:
+            return minute;
+        case Field::hour:
+            return minute + 60 * (59 - tm.tm_min);
+        case Field::day:
+        default:
+            std::tm midnight = tm;
+            midnight.tm_mday++;
+            midnight.tm_hour  = 0;
+            midnight.tm_min   = 0;
+            midnight.tm_sec   = 0;
+            midnight.tm_isdst = -1;
+            return std::mktime(&midnight);
+        }
+    }
+
+    /** The source of the current time. */
+    Source mSource;
+
+    /** Cached formats, in a list so that references to them stay valid. */
+    std::list<Entry> mEntries;
+
+    /** Stream used for formatting, kept to avoid constructing it. */
+    std::ostringstream mStream;
+
+    /** The broken-down local time. */
+    std::tm mTm{};
+
+    /** The time mTm was computed for. */
+    std::time_t mTmTime = kNever;
+};
+
+/**
+ * Returns the current local time, formatted according to the std::put_time()
+ * format string.
+ *
+ * @param[in] format The format.
+ *
+ * @return The formatted time.
+ */
+inline std::string getTime(const std::string &format)
+{
+    return TimeService::shared().get(format);
 }
 
 } // namespace Util